@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../my_shared_ptr/my_atomic_shared_ptr.hh"
+#include "../my_shared_ptr/spinlock.hh"
+#include "../utils/xorshift.hh"
+
+// Contention of the lock policies of my_atomic_shared_ptr
+//
+// Workloads, every thread running the same loop:
+// - lock: lock, increment a shared counter, unlock
+// - atomic: my_atomic_shared_ptr, 90% load, 10% compare_exchange
+// The atomic workload also runs the lock-free policy, as a reference.
+//
+// Usage: bench_lock.bin [--workload lock|atomic|all] [--threads max]
+//          [--ops ops_per_thread] [--no-header]
+// Threads go from 1 to max (default 64), doubling (max included).
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::vector<std::string> workloads{"lock", "atomic"};
+  std::size_t max_threads = 64;
+  std::size_t ops = 100000;
+  bool header = true;
+};
+
+// Run body(tid) on nb_threads threads, returns the duration in seconds
+template <class F> double run_threads(std::size_t nb_threads, F body) {
+  std::atomic<bool> ready{false};
+  std::vector<std::thread> ths;
+
+  for (std::size_t tid = 0; tid < nb_threads; ++tid)
+    ths.emplace_back([&, tid] {
+      while (!ready)
+        std::this_thread::yield();
+      body(tid);
+    });
+
+  auto start = Clock::now();
+  ready = true;
+  for (auto &t : ths)
+    t.join();
+  std::chrono::duration<double> dur = Clock::now() - start;
+  return dur.count();
+}
+
+template <class Lock> double run_lock(std::size_t nb_threads, std::size_t ops) {
+  Lock lock;
+  std::uint64_t counter = 0;
+
+  double res = run_threads(nb_threads, [&](std::size_t) {
+    for (std::size_t i = 0; i < ops; ++i) {
+      std::lock_guard<Lock> guard(lock);
+      ++counter;
+    }
+  });
+
+  if (counter != nb_threads * ops)
+    throw std::logic_error{"lock: lost increments"};
+  return res;
+}
+
+template <class Lock>
+double run_atomic(std::size_t nb_threads, std::size_t ops) {
+  my_atomic_shared_ptr<std::uint64_t, Lock> ptr(
+      make_my_shared<std::uint64_t>(0));
+
+  return run_threads(nb_threads, [&](std::size_t tid) {
+    Xorshift rng(tid + 1);
+    for (std::size_t i = 0; i < ops; ++i) {
+      auto val = ptr.load();
+      if (rng.next(10) == 0)
+        ptr.compare_exchange(val, make_my_shared<std::uint64_t>(*val + 1));
+    }
+  });
+}
+
+using Run = double (*)(std::size_t nb_threads, std::size_t ops);
+
+void bench(const Options &opts, const std::string &workload, const char *name,
+           Run run) {
+  for (std::size_t nb_threads = 1;;
+       nb_threads = std::min(2 * nb_threads, opts.max_threads)) {
+    double seconds = run(nb_threads, opts.ops);
+    std::size_t ops = nb_threads * opts.ops;
+    std::cout << workload << "," << name << "," << nb_threads << "," << ops
+              << "," << seconds << ","
+              << static_cast<std::uint64_t>(ops / seconds) << std::endl;
+
+    if (nb_threads >= opts.max_threads)
+      break;
+  }
+}
+
+Options parse(int argc, char **argv) {
+  Options res;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string val = i + 1 < argc ? argv[i + 1] : "";
+
+    if (arg == "--workload") {
+      if (val != "all")
+        res.workloads = {val};
+      ++i;
+    } else if (arg == "--threads") {
+      res.max_threads = std::stoul(val);
+      ++i;
+    } else if (arg == "--ops") {
+      res.ops = std::stoul(val);
+      ++i;
+    } else if (arg == "--no-header")
+      res.header = false;
+    else
+      throw std::invalid_argument{"unknown argument: " + arg};
+  }
+  return res;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts = parse(argc, argv);
+
+  if (opts.header)
+    std::cout << "workload,lock,threads,ops,seconds,ops_per_sec" << std::endl;
+
+  for (const auto &workload : opts.workloads) {
+    if (workload == "lock") {
+      bench(opts, workload, "std_mutex", run_lock<std::mutex>);
+      bench(opts, workload, "tas", run_lock<Spinlock>);
+      bench(opts, workload, "ttas", run_lock<TtasLock>);
+      bench(opts, workload, "ticket", run_lock<TicketLock>);
+      bench(opts, workload, "mcs", run_lock<McsLock>);
+    } else if (workload == "atomic") {
+      bench(opts, workload, "lock_free", run_atomic<LockFree>);
+      bench(opts, workload, "std_mutex", run_atomic<std::mutex>);
+      bench(opts, workload, "tas", run_atomic<Spinlock>);
+      bench(opts, workload, "ttas", run_atomic<TtasLock>);
+      bench(opts, workload, "ticket", run_atomic<TicketLock>);
+      bench(opts, workload, "mcs", run_atomic<McsLock>);
+    } else
+      throw std::invalid_argument{"unknown workload: " + workload};
+  }
+}
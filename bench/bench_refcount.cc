@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../my_shared_ptr/my_shared_ptr.hh"
+#include "../utils/xorshift.hh"
+
+// Copy / destroy throughput of my_shared_ptr, for the counter selected at
+// build time (COUNTER_NAME, COUNTER: counter policy, default one if not
+// defined)
+//
+// Workloads, every thread running the same loop:
+// - owner: each thread copies and drops objects it created
+// - shared: the threads copy and drop OBJS_COUNT objects created by the main
+//   thread (test_refcount_multi style), not available with RefCounter
+// An op is a copy and its destruction.
+//
+// Usage: bench_refcount_<counter>.bin [--workload owner|shared|all]
+//          [--threads max] [--ops ops_per_thread] [--no-header]
+// Threads go from 1 to max, doubling (max included).
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#ifdef COUNTER
+using Ptr = my_shared_ptr<int, COUNTER>;
+#else
+using Ptr = my_shared_ptr<int>;
+#endif
+
+constexpr bool IS_LOCAL = std::is_same<Ptr, my_local_shared_ptr<int>>::value;
+
+constexpr std::size_t OBJS_COUNT = 64;
+constexpr std::size_t COPIES_COUNT = 8;
+
+struct Options {
+  std::vector<std::string> workloads =
+      IS_LOCAL ? std::vector<std::string>{"owner"}
+               : std::vector<std::string>{"owner", "shared"};
+  std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t ops = 1000000;
+  bool header = true;
+};
+
+// Copies kept a little while, so they're not optimized away
+void copy_drop(const std::vector<Ptr> &objs, std::size_t ops,
+               std::size_t seed) {
+  Xorshift rng(seed);
+  Ptr copies[COPIES_COUNT];
+
+  for (std::size_t i = 0; i < ops; ++i)
+    copies[i % COPIES_COUNT] = objs[rng.next(objs.size())];
+}
+
+std::vector<Ptr> make_objs() {
+  std::vector<Ptr> res;
+  for (std::size_t i = 0; i < OBJS_COUNT; ++i)
+    res.push_back(Ptr::wrapper_make_shared(int(i)));
+  return res;
+}
+
+double run(const std::string &workload, std::size_t nb_threads,
+           std::size_t ops) {
+  std::vector<Ptr> shared_objs;
+  if (workload == "shared" && !IS_LOCAL)
+    shared_objs = make_objs();
+  else if (workload != "owner")
+    throw std::invalid_argument{"unknown workload: " + workload};
+
+  std::atomic<bool> ready{false};
+  std::vector<std::thread> ths;
+  for (std::size_t tid = 0; tid < nb_threads; ++tid)
+    ths.emplace_back([&, tid] {
+      std::vector<Ptr> objs;
+      if (shared_objs.empty())
+        objs = make_objs();
+
+      while (!ready)
+        std::this_thread::yield();
+
+      copy_drop(shared_objs.empty() ? objs : shared_objs, ops, tid + 1);
+    });
+
+  auto start = Clock::now();
+  ready = true;
+  for (auto &t : ths)
+    t.join();
+  std::chrono::duration<double> dur = Clock::now() - start;
+  return dur.count();
+}
+
+Options parse(int argc, char **argv) {
+  Options res;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string val = i + 1 < argc ? argv[i + 1] : "";
+
+    if (arg == "--workload") {
+      if (val != "all")
+        res.workloads = {val};
+      ++i;
+    } else if (arg == "--threads") {
+      res.max_threads = std::stoul(val);
+      ++i;
+    } else if (arg == "--ops") {
+      res.ops = std::stoul(val);
+      ++i;
+    } else if (arg == "--no-header")
+      res.header = false;
+    else
+      throw std::invalid_argument{"unknown argument: " + arg};
+  }
+  return res;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts = parse(argc, argv);
+
+  if (opts.header)
+    std::cout << "counter,workload,threads,ops,seconds,ops_per_sec"
+              << std::endl;
+
+  for (const auto &workload : opts.workloads)
+    for (std::size_t nb_threads = 1;;
+         nb_threads = std::min(2 * nb_threads, opts.max_threads)) {
+      double seconds = run(workload, nb_threads, opts.ops);
+      std::size_t ops = nb_threads * opts.ops;
+      std::cout << COUNTER_NAME << "," << workload << "," << nb_threads << ","
+                << ops << "," << seconds << ","
+                << static_cast<std::uint64_t>(ops / seconds) << std::endl;
+
+      if (nb_threads >= opts.max_threads)
+        break;
+    }
+}
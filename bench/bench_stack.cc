@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../stack_cc/stack.hh"
+#include "../utils/xorshift.hh"
+
+// Throughput / latency of the Stack selected with IMPL_*
+//
+// Workloads, every thread running the same loop:
+// - push: push only, on an empty stack
+// - pop: pop only, on a stack filled with all the values popped
+// - mixed: push then pop
+// - find: 90% find, 5% push, 5% pop, on a stack of FIND_RANGE values
+// Every op is timed, the latency percentiles are over all threads.
+// CAS retries are reported when the stack exposes stats(), -1 otherwise.
+//
+// Usage: bench_stack_<impl>.bin [--workload push|pop|mixed|find|all]
+//          [--threads max] [--ops ops_per_thread] [--format csv|json]
+//          [--no-header] [--no-footer]
+// Threads go from 1 to max, doubling (max included).
+// --no-header / --no-footer chain the output of several runs into one: no CSV
+// header / no opening "[" (the first object follows a previous one), and no
+// closing "]".
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Value = std::uint64_t;
+
+constexpr Value FIND_RANGE = 1024;
+
+struct Options {
+  std::vector<std::string> workloads{"push", "pop", "mixed", "find"};
+  std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t ops = 100000;
+  bool json = false;
+  bool header = true;
+  bool footer = true;
+};
+
+struct Result {
+  std::string workload;
+  std::size_t threads;
+  std::size_t ops;
+  double seconds;
+  std::uint64_t p50;
+  std::uint64_t p99;
+  std::uint64_t p999;
+  std::int64_t cas_retries;
+};
+
+template <class S, class = void> struct HasStats : std::false_type {};
+
+template <class S>
+struct HasStats<S, std::void_t<decltype(std::declval<S &>().stats())>>
+    : std::true_type {};
+
+template <class S> std::int64_t cas_retries(S &stack) {
+  if constexpr (HasStats<S>::value) {
+    return static_cast<std::int64_t>(stack.stats().cas_retries);
+  } else {
+    (void)stack;
+    return -1;
+  }
+}
+
+// One op of the workload, i: index of the op in the thread
+using Op = void (*)(Stack<Value> &, Xorshift &, std::size_t tid,
+                    std::size_t i);
+
+void op_push(Stack<Value> &stack, Xorshift &, std::size_t tid,
+             std::size_t i) {
+  stack.push(tid << 32 | i);
+}
+
+void op_pop(Stack<Value> &stack, Xorshift &, std::size_t, std::size_t) {
+  stack.try_pop();
+}
+
+void op_mixed(Stack<Value> &stack, Xorshift &, std::size_t tid,
+              std::size_t i) {
+  stack.push(tid << 32 | i);
+  stack.try_pop();
+}
+
+void op_find(Stack<Value> &stack, Xorshift &rng, std::size_t, std::size_t) {
+  std::size_t r = rng.next(20);
+  Value val = rng.next(2 * FIND_RANGE);
+  if (r == 0)
+    stack.push(val);
+  else if (r == 1)
+    stack.try_pop();
+  else
+    stack.find(val);
+}
+
+std::uint64_t percentile(const std::vector<std::uint32_t> &sorted, double q) {
+  if (sorted.empty())
+    return 0;
+  auto pos = static_cast<std::size_t>(q * sorted.size());
+  return sorted[std::min(pos, sorted.size() - 1)];
+}
+
+Result run(const std::string &workload, std::size_t nb_threads,
+           std::size_t ops) {
+  Stack<Value> stack;
+  Op op;
+
+  if (workload == "push")
+    op = op_push;
+  else if (workload == "pop") {
+    op = op_pop;
+    for (std::size_t i = 0; i < nb_threads * ops; ++i)
+      stack.push(i);
+  } else if (workload == "mixed")
+    op = op_mixed;
+  else if (workload == "find") {
+    op = op_find;
+    for (Value i = 0; i < FIND_RANGE; ++i)
+      stack.push(i);
+  } else
+    throw std::invalid_argument{"unknown workload: " + workload};
+
+  std::int64_t retries_before = cas_retries(stack);
+
+  std::vector<std::vector<std::uint32_t>> lats(nb_threads);
+  std::atomic<bool> ready{false};
+  std::vector<std::thread> ths;
+
+  for (std::size_t tid = 0; tid < nb_threads; ++tid)
+    ths.emplace_back([&, tid] {
+      auto &lat = lats[tid];
+      lat.reserve(ops);
+      Xorshift rng(tid + 1);
+
+      while (!ready)
+        continue;
+
+      for (std::size_t i = 0; i < ops; ++i) {
+        auto start = Clock::now();
+        op(stack, rng, tid, i);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      Clock::now() - start)
+                      .count();
+        lat.push_back(static_cast<std::uint32_t>(
+            std::min<std::int64_t>(ns, UINT32_MAX)));
+      }
+    });
+
+  auto start = Clock::now();
+  ready = true;
+  for (auto &t : ths)
+    t.join();
+  std::chrono::duration<double> dur = Clock::now() - start;
+
+  std::vector<std::uint32_t> all;
+  all.reserve(nb_threads * ops);
+  for (auto &lat : lats)
+    all.insert(all.end(), lat.begin(), lat.end());
+  std::sort(all.begin(), all.end());
+
+  std::int64_t retries = cas_retries(stack);
+  if (retries >= 0)
+    retries -= retries_before;
+
+  return Result{workload,
+                nb_threads,
+                nb_threads * ops,
+                dur.count(),
+                percentile(all, 0.5),
+                percentile(all, 0.99),
+                percentile(all, 0.999),
+                retries};
+}
+
+void print_csv_header() {
+  std::cout << "impl,workload,threads,ops,seconds,ops_per_sec,p50_ns,p99_ns,"
+               "p999_ns,cas_retries"
+            << std::endl;
+}
+
+void print_csv(const Result &r) {
+  std::cout << IMPL_NAME << "," << r.workload << "," << r.threads << ","
+            << r.ops << "," << r.seconds << ","
+            << static_cast<std::uint64_t>(r.ops / r.seconds) << "," << r.p50
+            << "," << r.p99 << "," << r.p999 << "," << r.cas_retries
+            << std::endl;
+}
+
+void print_json(const Result &r, bool first) {
+  std::cout << (first ? "  " : ",\n  ") << "{\"impl\": \"" << IMPL_NAME
+            << "\", \"workload\": \"" << r.workload
+            << "\", \"threads\": " << r.threads << ", \"ops\": " << r.ops
+            << ", \"seconds\": " << r.seconds << ", \"ops_per_sec\": "
+            << static_cast<std::uint64_t>(r.ops / r.seconds)
+            << ", \"p50_ns\": " << r.p50 << ", \"p99_ns\": " << r.p99
+            << ", \"p999_ns\": " << r.p999
+            << ", \"cas_retries\": " << r.cas_retries << "}";
+}
+
+Options parse(int argc, char **argv) {
+  Options res;
+  const auto workloads = res.workloads;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next_val = [&]() -> std::string {
+      if (i + 1 >= argc)
+        throw std::invalid_argument{"missing value after " + arg};
+      return argv[++i];
+    };
+
+    if (arg == "--workload") {
+      std::string val = next_val();
+      if (val == "all")
+        res.workloads = workloads;
+      else if (std::find(workloads.begin(), workloads.end(), val) !=
+               workloads.end())
+        res.workloads = {val};
+      else
+        throw std::invalid_argument{"unknown workload: " + val};
+    } else if (arg == "--threads")
+      res.max_threads = std::stoul(next_val());
+    else if (arg == "--ops")
+      res.ops = std::stoul(next_val());
+    else if (arg == "--format") {
+      std::string val = next_val();
+      if (val != "csv" && val != "json")
+        throw std::invalid_argument{"unknown format: " + val};
+      res.json = val == "json";
+    } else if (arg == "--no-header")
+      res.header = false;
+    else if (arg == "--no-footer")
+      res.footer = false;
+    else
+      throw std::invalid_argument{"unknown argument: " + arg};
+  }
+  return res;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts = parse(argc, argv);
+
+  if (opts.json && opts.header)
+    std::cout << "[\n";
+  else if (opts.header)
+    print_csv_header();
+
+  bool first = opts.header;
+  for (const auto &workload : opts.workloads)
+    for (std::size_t nb_threads = 1;;
+         nb_threads = std::min(2 * nb_threads, opts.max_threads)) {
+      Result r = run(workload, nb_threads, opts.ops);
+      if (opts.json)
+        print_json(r, first);
+      else
+        print_csv(r);
+      first = false;
+
+      if (nb_threads >= opts.max_threads)
+        break;
+    }
+
+  if (opts.json && opts.footer)
+    std::cout << "\n]" << std::endl;
+}
@@ -0,0 +1,120 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "ws_deque.hh"
+
+namespace {
+
+constexpr std::size_t ITEMS_COUNT = 512 * 1024;
+constexpr std::size_t THIEVES_COUNT = 4;
+
+struct ValCounter {
+  std::atomic<int> n;
+  char offset[64]; // to avoid false sharing
+
+  ValCounter() : n(0) {}
+};
+
+std::unique_ptr<std::vector<ValCounter>> g_out;
+
+std::unique_ptr<WsDeque<std::size_t>> g_deque;
+std::atomic<bool> g_ready;
+std::atomic<bool> g_done;
+
+// Pops once every pop_period pushes, then empties the deque
+void runner_owner(std::size_t pop_period) {
+  while (!g_ready)
+    continue;
+
+  std::size_t next;
+  for (std::size_t i = 0; i < ITEMS_COUNT; ++i) {
+    g_deque->push(i);
+    if (i % pop_period == 0 && g_deque->try_pop(next))
+      ++((*g_out)[next].n);
+  }
+
+  // Fails once empty, or when a thief took the last value
+  while (g_deque->try_pop(next))
+    ++((*g_out)[next].n);
+  g_done = true;
+}
+
+void runner_thief() {
+  while (!g_ready)
+    continue;
+
+  std::size_t next;
+  while (!g_done || !g_deque->empty())
+    if (g_deque->try_steal(next))
+      ++((*g_out)[next].n);
+}
+
+void run_test(std::size_t pop_period) {
+  g_ready = false;
+  g_done = false;
+  // Grows while the thieves steal
+  g_deque = std::make_unique<WsDeque<std::size_t>>(2);
+  g_out = std::make_unique<std::vector<ValCounter>>(ITEMS_COUNT);
+
+  std::vector<std::thread> ths;
+  ths.emplace_back(runner_owner, pop_period);
+  for (std::size_t i = 0; i < THIEVES_COUNT; ++i)
+    ths.emplace_back(runner_thief);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(g_deque->empty());
+  for (const auto &x : *g_out)
+    REQUIRE(x.n == 1);
+}
+
+} // namespace
+
+TEST_CASE("deque push / pop / steal") {
+  REQUIRE_THROWS(WsDeque<int>(12));
+
+  WsDeque<int> deque(4);
+  int val;
+  REQUIRE(!deque.try_pop(val));
+  REQUIRE(!deque.try_steal(val));
+
+  for (int i = 0; i < 100; ++i)
+    deque.push(i);
+  REQUIRE(deque.size() == 100);
+  REQUIRE(deque.capacity() == 128);
+
+  // Thieves take the oldest values, the owner the newest
+  for (int i = 0; i < 10; ++i) {
+    REQUIRE(deque.try_steal(val));
+    REQUIRE(val == i);
+  }
+  for (int i = 99; i >= 10; --i) {
+    REQUIRE(deque.try_pop(val));
+    REQUIRE(val == i);
+  }
+  REQUIRE(!deque.try_pop(val));
+  REQUIRE(!deque.try_steal(val));
+  REQUIRE(deque.empty());
+
+  // Circular: positions keep increasing, cells are reused
+  for (int lap = 0; lap < 3; ++lap) {
+    for (int i = 0; i < 128; ++i)
+      deque.push(i);
+    for (int i = 0; i < 128; ++i) {
+      REQUIRE(deque.try_steal(val));
+      REQUIRE(val == i);
+    }
+  }
+  REQUIRE(deque.capacity() == 128);
+}
+
+TEST_CASE("owner push / pop + N thieves") { run_test(8); }
+
+// The deque is mostly empty: pops and steals race for the last value
+TEST_CASE("owner push / pop + N thieves, last value") { run_test(1); }
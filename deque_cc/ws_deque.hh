@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../epoch/epoch.hh"
+
+// Work-stealing deque (Chase, Lev 2005; C11 orderings of Le et al. 2013)
+//
+// The owner thread pushes and pops at the bottom, any other thread steals at
+// the top. push and pop only write bottom: no CAS, except for a pop racing the
+// thieves for the last value. A thief claims the top value with one CAS on
+// top.
+// The array is circular, indexed by bottom / top modulo its capacity, and
+// doubles when full: the owner copies the live values to a new array and
+// publishes it. Thieves may still read the old one, it is retired in the epoch
+// domain, and thieves read the array inside a critical section.
+//
+// A thief reads its value before the CAS that claims it, while the owner may
+// overwrite the cell: values are stored in atomics, T must be trivially
+// copyable (task pointers, indices)
+template <class T> class WsDeque {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "WsDeque values are copied by racing threads");
+
+  struct Array {
+    const std::int64_t mask;
+    std::atomic<T> *const cells;
+
+    explicit Array(std::int64_t capacity)
+        : mask(capacity - 1), cells(new std::atomic<T>[capacity]) {}
+
+    ~Array() { delete[] cells; }
+
+    Array(const Array &) = delete;
+    Array &operator=(const Array &) = delete;
+
+    std::int64_t capacity() const { return mask + 1; }
+
+    T get(std::int64_t pos) const {
+      return cells[pos & mask].load(std::memory_order_relaxed);
+    }
+
+    void put(std::int64_t pos, T val) {
+      cells[pos & mask].store(val, std::memory_order_relaxed);
+    }
+  };
+
+public:
+  // capacity must be a power of 2
+  explicit WsDeque(std::size_t capacity = 64)
+      : _bottom(0), _top(0), _array(nullptr) {
+    if (capacity < 2 || (capacity & (capacity - 1)))
+      throw std::invalid_argument{"WsDeque capacity must be a power of 2"};
+    _array.store(new Array(capacity), std::memory_order_relaxed);
+  }
+
+  WsDeque(const WsDeque &) = delete;
+  WsDeque &operator=(const WsDeque &) = delete;
+
+  // Arrays replaced by a grow are freed by the epoch domain
+  ~WsDeque() { delete _array.load(std::memory_order_relaxed); }
+
+  // Owner only
+  void push(T val) {
+    std::int64_t b = _bottom.load(std::memory_order_relaxed);
+    std::int64_t t = _top.load(std::memory_order_acquire);
+    Array *a = _array.load(std::memory_order_relaxed);
+
+    if (b - t > a->mask)
+      a = _grow(a, t, b);
+
+    a->put(b, val);
+    // The value before the new bottom, for the thieves
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only, LIFO
+  bool try_pop(T &val) {
+    std::int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    Array *a = _array.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    // Either the thieves see the new bottom, or we see their top
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = _top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      // Empty
+      _bottom.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    val = a->get(b);
+    if (t < b)
+      return true;
+
+    // Last value, take it from the thieves
+    bool res = _top.compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return res;
+  }
+
+  // Any thread, FIFO
+  // False when empty, or when another thread took the top value first
+  bool try_steal(T &val) {
+    std::int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t b = _bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+      return false;
+
+    EpochGuard guard;
+    Array *a = _array.load(std::memory_order_acquire);
+    T res = a->get(t);
+    if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      return false;
+
+    val = res;
+    return true;
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  std::size_t size() const {
+    std::int64_t b = _bottom.load();
+    std::int64_t t = _top.load();
+    return b > t ? b - t : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  std::size_t capacity() const { return _array.load()->capacity(); }
+
+private:
+  // bottom only written by the owner, top by the thieves and the last pop
+  alignas(64) std::atomic<std::int64_t> _bottom;
+  alignas(64) std::atomic<std::int64_t> _top;
+  std::atomic<Array *> _array;
+
+  // Owner only: doubles the capacity, keeps the positions of the values
+  Array *_grow(Array *old, std::int64_t t, std::int64_t b) {
+    Array *res = new Array(old->capacity() * 2);
+    for (std::int64_t i = t; i < b; ++i)
+      res->put(i, old->get(i));
+
+    _array.store(res, std::memory_order_release);
+    epoch_retire(old);
+    return res;
+  }
+};
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation (Keir Fraser, 2004)
+//
+// Threads announce the global epoch when they enter a critical section, and
+// can only read shared nodes inside it.
+// A removed node is retired with the global epoch of its removal. The global
+// epoch only advances when all threads inside a critical section announced
+// the current epoch, so once it advanced twice, no thread can still read the
+// node.
+// Each thread has 3 limbo lists, one for each of the epochs that may still be
+// alive (current, previous, and the one being freed)
+
+class EpochDomain {
+
+public:
+  struct Retired {
+    void *ptr;
+    void (*deleter)(void *);
+  };
+
+  static EpochDomain &instance() {
+    static EpochDomain res;
+    return res;
+  }
+
+  EpochDomain(const EpochDomain &) = delete;
+  EpochDomain &operator=(const EpochDomain &) = delete;
+
+  ~EpochDomain() {
+    // Only called at exit, no more critical sections
+    for (auto &l : _orphans)
+      _free_limbo(l);
+
+    Record *rec = _records.load(std::memory_order_acquire);
+    while (rec) {
+      Record *next = rec->next;
+      delete rec;
+      rec = next;
+    }
+  }
+
+  // Critical sections can be nested
+  void enter() {
+    auto &local = _local();
+    if (local.nesting++)
+      return;
+
+    std::uint64_t epoch = _epoch.load(std::memory_order_relaxed);
+    local.rec->state.store(epoch << 1 | 1, std::memory_order_relaxed);
+    // The announce must be visible before reading any shared node
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (++local.enters % ADVANCE_PERIOD == 0)
+      _try_advance();
+    _reclaim(local, _epoch.load(std::memory_order_acquire));
+  }
+
+  void leave() {
+    auto &local = _local();
+    if (--local.nesting)
+      return;
+    local.rec->state.store(0, std::memory_order_release);
+  }
+
+  void retire(void *ptr, void (*deleter)(void *)) {
+    auto &local = _local();
+    std::uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+
+    Limbo &limbo = local.limbo[epoch % 3];
+    if (limbo.epoch != epoch) {
+      // Epoch at least 3 behind, safe to free
+      _free_limbo(limbo);
+      limbo.epoch = epoch;
+    }
+    limbo.nodes.push_back(Retired{ptr, deleter});
+
+    if (++local.retired % RECLAIM_PERIOD == 0) {
+      _try_advance();
+      _reclaim(local, _epoch.load(std::memory_order_acquire));
+    }
+  }
+
+  // Try to free all nodes retired by the calling thread, and the ones retired
+  // by exited threads
+  void cleanup() {
+    auto &local = _local();
+    std::lock_guard<std::mutex> lock(_orphans_mut);
+    _cleanup(local);
+  }
+
+  std::uint64_t epoch() const { return _epoch.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr std::size_t ADVANCE_PERIOD = 64;
+  static constexpr std::size_t RECLAIM_PERIOD = 64;
+
+  // state: announced epoch << 1 | active
+  struct alignas(64) Record {
+    std::atomic<std::uint64_t> state;
+    std::atomic<bool> used;
+    Record *next;
+
+    Record() : state(0), used(true), next(nullptr) {}
+  };
+
+  struct Limbo {
+    std::uint64_t epoch;
+    std::vector<Retired> nodes;
+  };
+
+  struct ThreadState {
+    Record *rec;
+    std::size_t nesting;
+    std::size_t enters;
+    std::size_t retired;
+    Limbo limbo[3];
+
+    ThreadState()
+        : rec(EpochDomain::instance()._acquire_record()), nesting(0),
+          enters(0), retired(0), limbo{} {}
+
+    ~ThreadState() { EpochDomain::instance()._on_thread_exit(*this); }
+  };
+
+  alignas(64) std::atomic<std::uint64_t> _epoch;
+  std::atomic<Record *> _records;
+
+  // Limbo lists of exited threads
+  std::mutex _orphans_mut;
+  std::vector<Limbo> _orphans;
+
+  EpochDomain() : _epoch(0), _records(nullptr) {}
+
+  static ThreadState &_local() {
+    thread_local ThreadState res;
+    return res;
+  }
+
+  Record *_acquire_record() {
+    for (Record *rec = _records.load(std::memory_order_acquire); rec;
+         rec = rec->next) {
+      bool used = false;
+      if (!rec->used.load(std::memory_order_relaxed) &&
+          rec->used.compare_exchange_strong(used, true,
+                                            std::memory_order_acquire))
+        return rec;
+    }
+
+    Record *rec = new Record;
+    rec->next = _records.load(std::memory_order_relaxed);
+    while (!_records.compare_exchange_weak(rec->next, rec,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+      continue;
+    return rec;
+  }
+
+  bool _try_advance() {
+    std::uint64_t epoch = _epoch.load(std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (Record *rec = _records.load(std::memory_order_acquire); rec;
+         rec = rec->next) {
+      std::uint64_t state = rec->state.load(std::memory_order_seq_cst);
+      if ((state & 1) && (state >> 1) != epoch)
+        return false;
+    }
+
+    return _epoch.compare_exchange_strong(epoch, epoch + 1,
+                                          std::memory_order_seq_cst);
+  }
+
+  static void _free_limbo(Limbo &limbo) {
+    // Deleters may retire other nodes, work on a detached list
+    std::vector<Retired> nodes;
+    nodes.swap(limbo.nodes);
+    for (auto &r : nodes)
+      r.deleter(r.ptr);
+  }
+
+  static void _reclaim(ThreadState &local, std::uint64_t epoch) {
+    for (auto &limbo : local.limbo)
+      if (!limbo.nodes.empty() && limbo.epoch + 2 <= epoch)
+        _free_limbo(limbo);
+  }
+
+  // Must hold _orphans_mut
+  void _cleanup(ThreadState &local) {
+    // Can't advance more than once while the thread is inside a section
+    for (int i = 0; i < 3; ++i)
+      _try_advance();
+
+    std::uint64_t epoch = _epoch.load(std::memory_order_acquire);
+    _reclaim(local, epoch);
+
+    std::vector<Limbo> orphans;
+    orphans.swap(_orphans);
+    for (auto &limbo : orphans) {
+      if (limbo.epoch + 2 <= epoch)
+        _free_limbo(limbo);
+      else
+        _orphans.push_back(std::move(limbo));
+    }
+  }
+
+  void _on_thread_exit(ThreadState &local) {
+    local.rec->state.store(0, std::memory_order_release);
+
+    // Serialized, so the last exiting thread sees all the others out of
+    // their sections, and frees everything still retired
+    std::lock_guard<std::mutex> lock(_orphans_mut);
+    _cleanup(local);
+    for (auto &limbo : local.limbo)
+      if (!limbo.nodes.empty())
+        _orphans.push_back(std::move(limbo));
+
+    local.rec->used.store(false, std::memory_order_release);
+  }
+};
+
+// RAII critical section
+class EpochGuard {
+public:
+  EpochGuard() : _active(true) { EpochDomain::instance().enter(); }
+
+  EpochGuard(EpochGuard &&g) : _active(g._active) { g._active = false; }
+
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+
+  ~EpochGuard() { release(); }
+
+  // Leave the section before the end of the scope
+  void release() {
+    if (_active)
+      EpochDomain::instance().leave();
+    _active = false;
+  }
+
+private:
+  bool _active;
+};
+
+template <class T> void epoch_retire(T *ptr) {
+  EpochDomain::instance().retire(
+      ptr, [](void *p) { delete static_cast<T *>(p); });
+}
+
+inline void epoch_retire(void *ptr, void (*deleter)(void *)) {
+  EpochDomain::instance().retire(ptr, deleter);
+}
+
+inline void epoch_cleanup() { EpochDomain::instance().cleanup(); }
@@ -0,0 +1,105 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../utils/xorshift.hh"
+#include "epoch.hh"
+
+namespace {
+
+constexpr std::size_t NB_THREADS = 8;
+constexpr std::size_t NB_ITERS = 100000;
+
+struct Obj {
+  static std::atomic<std::size_t> created;
+  static std::atomic<std::size_t> deleted;
+
+  std::size_t id;
+  std::size_t check;
+
+  Obj(std::size_t id) : id(id), check(~id) { ++created; }
+
+  ~Obj() {
+    check = 0;
+    ++deleted;
+  }
+};
+
+std::atomic<std::size_t> Obj::created{};
+std::atomic<std::size_t> Obj::deleted{};
+
+std::atomic<Obj *> g_ptr;
+std::atomic<bool> g_ready;
+
+void runner(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  Xorshift rng(tid + 1);
+
+  for (std::size_t i = 0; i < NB_ITERS; ++i) {
+    EpochGuard guard;
+    Obj *obj = g_ptr.load();
+    REQUIRE(obj->check == ~obj->id);
+
+    if (rng.next(4) == 0) {
+      Obj *old = g_ptr.exchange(new Obj(tid * NB_ITERS + i));
+      epoch_retire(old);
+    }
+
+    REQUIRE(obj->check == ~obj->id);
+  }
+}
+
+} // namespace
+
+TEST_CASE("epoch retire") {
+  Obj::created = 0;
+  Obj::deleted = 0;
+
+  Obj *obj = new Obj(1);
+
+  {
+    EpochGuard guard;
+    epoch_retire(obj);
+    epoch_cleanup();
+    REQUIRE(Obj::deleted == 0);
+
+    {
+      EpochGuard nested;
+      REQUIRE(obj->check == ~obj->id);
+    }
+
+    epoch_cleanup();
+    REQUIRE(Obj::deleted == 0);
+
+    guard.release();
+    epoch_cleanup();
+    REQUIRE(Obj::deleted == 1);
+  }
+
+  epoch_retire(new Obj(2));
+  epoch_cleanup();
+  REQUIRE(Obj::deleted == 2);
+}
+
+TEST_CASE("epoch multi read / retire") {
+  Obj::created = 0;
+  Obj::deleted = 0;
+  g_ptr = new Obj(0);
+
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < NB_THREADS; ++i)
+    ths.emplace_back(runner, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  epoch_retire(g_ptr.exchange(nullptr));
+  epoch_cleanup();
+  REQUIRE(Obj::deleted == Obj::created);
+}
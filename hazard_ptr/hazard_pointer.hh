@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Hazard pointers reclamation (Maged Michael, 2004)
+//
+// Before reading a shared node, a thread publishes its address in a hazard
+// slot, and then checks the node is still reachable.
+// Removed nodes are retired into a per-thread list, and only freed once no
+// hazard slot points to them.
+// The retire list is scanned once it reaches a threshold proportional to the
+// number of hazard slots, that amortizes the cost of a scan to O(1) per retire
+
+class HazardDomain {
+
+public:
+  struct Slot {
+    std::atomic<const void *> ptr;
+    std::atomic<bool> active;
+    Slot *next;
+
+    Slot() : ptr(nullptr), active(true), next(nullptr) {}
+  };
+
+  struct Retired {
+    void *ptr;
+    void (*deleter)(void *);
+  };
+
+  static HazardDomain &instance() {
+    static HazardDomain res;
+    return res;
+  }
+
+  HazardDomain(const HazardDomain &) = delete;
+  HazardDomain &operator=(const HazardDomain &) = delete;
+
+  ~HazardDomain() {
+    // Only called at exit, no more hazards
+    for (auto &r : _orphans)
+      r.deleter(r.ptr);
+
+    Slot *slot = _slots.load(std::memory_order_acquire);
+    while (slot) {
+      Slot *next = slot->next;
+      delete slot;
+      slot = next;
+    }
+  }
+
+  Slot *acquire_slot() {
+    auto &cache = _local().cache;
+    if (!cache.empty()) {
+      Slot *res = cache.back();
+      cache.pop_back();
+      return res;
+    }
+
+    // Reuse an inactive slot
+    for (Slot *slot = _slots.load(std::memory_order_acquire); slot;
+         slot = slot->next) {
+      bool active = false;
+      if (!slot->active.load(std::memory_order_relaxed) &&
+          slot->active.compare_exchange_strong(active, true,
+                                               std::memory_order_acquire))
+        return slot;
+    }
+
+    Slot *slot = new Slot;
+    slot->next = _slots.load(std::memory_order_relaxed);
+    while (!_slots.compare_exchange_weak(slot->next, slot,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed))
+      continue;
+    _nb_slots.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+  }
+
+  void release_slot(Slot *slot) {
+    slot->ptr.store(nullptr, std::memory_order_release);
+
+    auto &cache = _local().cache;
+    if (cache.size() < CACHE_SIZE)
+      cache.push_back(slot);
+    else
+      slot->active.store(false, std::memory_order_release);
+  }
+
+  void retire(void *ptr, void (*deleter)(void *)) {
+    auto &local = _local();
+    local.retired.push_back(Retired{ptr, deleter});
+    if (local.retired.size() < _threshold())
+      return;
+
+    if (_nb_orphans.load(std::memory_order_relaxed)) {
+      std::unique_lock<std::mutex> lock(_orphans_mut, std::try_to_lock);
+      if (lock)
+        _adopt_orphans(local);
+    }
+    _scan(local);
+  }
+
+  // Free all retired nodes of the calling thread that are not protected
+  // Also adopt the nodes retired by exited threads
+  void cleanup() {
+    auto &local = _local();
+    std::lock_guard<std::mutex> lock(_orphans_mut);
+    _adopt_orphans(local);
+    _scan(local);
+  }
+
+private:
+  static constexpr std::size_t CACHE_SIZE = 8;
+  static constexpr std::size_t MIN_THRESHOLD = 64;
+
+  struct ThreadState {
+    std::vector<Slot *> cache;
+    std::vector<Retired> retired;
+    std::vector<const void *> hazards;
+
+    ~ThreadState() { HazardDomain::instance()._on_thread_exit(*this); }
+  };
+
+  std::atomic<Slot *> _slots;
+  std::atomic<std::size_t> _nb_slots;
+
+  // Nodes retired by exited threads, still protected at the time
+  std::mutex _orphans_mut;
+  std::vector<Retired> _orphans;
+  std::atomic<std::size_t> _nb_orphans;
+
+  HazardDomain() : _slots(nullptr), _nb_slots(0), _nb_orphans(0) {}
+
+  static ThreadState &_local() {
+    thread_local ThreadState res;
+    return res;
+  }
+
+  std::size_t _threshold() const {
+    return std::max(MIN_THRESHOLD,
+                    2 * _nb_slots.load(std::memory_order_relaxed));
+  }
+
+  void _scan(ThreadState &local) {
+    // Pairs with the store / load of the protecting thread:
+    // either it sees the node unlinked, or we see its hazard
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto &hazards = local.hazards;
+    hazards.clear();
+    for (Slot *slot = _slots.load(std::memory_order_acquire); slot;
+         slot = slot->next) {
+      const void *ptr = slot->ptr.load(std::memory_order_acquire);
+      if (ptr)
+        hazards.push_back(ptr);
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    // Deleters may retire other nodes, work on a detached list
+    std::vector<Retired> retired;
+    retired.swap(local.retired);
+    auto it = std::partition(retired.begin(), retired.end(), [&](Retired &r) {
+      return std::binary_search(hazards.begin(), hazards.end(), r.ptr);
+    });
+
+    std::vector<Retired> kept(retired.begin(), it);
+    for (; it != retired.end(); ++it)
+      it->deleter(it->ptr);
+
+    local.retired.insert(local.retired.end(), kept.begin(), kept.end());
+  }
+
+  // Must hold _orphans_mut
+  void _adopt_orphans(ThreadState &local) {
+    local.retired.insert(local.retired.end(), _orphans.begin(),
+                         _orphans.end());
+    _orphans.clear();
+    _nb_orphans.store(0, std::memory_order_relaxed);
+  }
+
+  void _on_thread_exit(ThreadState &local) {
+    for (Slot *slot : local.cache) {
+      slot->ptr.store(nullptr, std::memory_order_release);
+      slot->active.store(false, std::memory_order_release);
+    }
+    local.cache.clear();
+
+    // Serialized, so the last exiting thread sees the hazards of all the
+    // others cleared, and frees everything still retired
+    std::lock_guard<std::mutex> lock(_orphans_mut);
+    _adopt_orphans(local);
+    _scan(local);
+    _orphans.swap(local.retired);
+    _nb_orphans.store(_orphans.size(), std::memory_order_relaxed);
+  }
+};
+
+// Owns a hazard slot, protecting at most one node at a time
+class HazardPointer {
+public:
+  // Empty, doesn't own any slot
+  HazardPointer() : _slot(nullptr) {}
+
+  HazardPointer(HazardPointer &&hp) : _slot(hp._slot) { hp._slot = nullptr; }
+
+  HazardPointer &operator=(HazardPointer &&hp) {
+    HazardPointer{std::move(hp)}.swap(*this);
+    return *this;
+  }
+
+  HazardPointer(const HazardPointer &) = delete;
+  HazardPointer &operator=(const HazardPointer &) = delete;
+
+  ~HazardPointer() {
+    if (_slot)
+      HazardDomain::instance().release_slot(_slot);
+  }
+
+  bool empty() const { return !_slot; }
+
+  void swap(HazardPointer &hp) { std::swap(_slot, hp._slot); }
+
+  // Publish the hazard, the caller must check afterwards that ptr is still
+  // reachable before using it
+  void reset_protection(const void *ptr = nullptr) {
+    _slot->ptr.store(ptr, std::memory_order_seq_cst);
+  }
+
+  // Protect ptr if it is still the value of src
+  // Otherwise update ptr with the current value and return false
+  template <class T> bool try_protect(T *&ptr, const std::atomic<T *> &src) {
+    T *old = ptr;
+    reset_protection(old);
+    ptr = src.load(std::memory_order_seq_cst);
+    if (ptr == old)
+      return true;
+
+    reset_protection();
+    return false;
+  }
+
+  template <class T> T *protect(const std::atomic<T *> &src) {
+    T *ptr = src.load(std::memory_order_relaxed);
+    while (!try_protect(ptr, src))
+      continue;
+    return ptr;
+  }
+
+  friend HazardPointer make_hazard_pointer();
+
+private:
+  HazardDomain::Slot *_slot;
+
+  explicit HazardPointer(HazardDomain::Slot *slot) : _slot(slot) {}
+};
+
+inline HazardPointer make_hazard_pointer() {
+  return HazardPointer{HazardDomain::instance().acquire_slot()};
+}
+
+template <class T> void hazard_retire(T *ptr) {
+  HazardDomain::instance().retire(
+      ptr, [](void *p) { delete static_cast<T *>(p); });
+}
+
+inline void hazard_retire(void *ptr, void (*deleter)(void *)) {
+  HazardDomain::instance().retire(ptr, deleter);
+}
+
+inline void hazard_cleanup() { HazardDomain::instance().cleanup(); }
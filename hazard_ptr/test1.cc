@@ -0,0 +1,105 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../utils/xorshift.hh"
+#include "hazard_pointer.hh"
+
+namespace {
+
+constexpr std::size_t NB_THREADS = 8;
+constexpr std::size_t NB_ITERS = 100000;
+
+struct Obj {
+  static std::atomic<std::size_t> created;
+  static std::atomic<std::size_t> deleted;
+
+  std::size_t id;
+  std::size_t check;
+
+  Obj(std::size_t id) : id(id), check(~id) { ++created; }
+
+  ~Obj() {
+    check = 0;
+    ++deleted;
+  }
+};
+
+std::atomic<std::size_t> Obj::created{};
+std::atomic<std::size_t> Obj::deleted{};
+
+std::atomic<Obj *> g_ptr;
+std::atomic<bool> g_ready;
+
+void runner(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  Xorshift rng(tid + 1);
+  HazardPointer hp = make_hazard_pointer();
+
+  for (std::size_t i = 0; i < NB_ITERS; ++i) {
+    Obj *obj = hp.protect(g_ptr);
+    REQUIRE(obj->check == ~obj->id);
+    hp.reset_protection();
+
+    if (rng.next(4) == 0) {
+      Obj *old = g_ptr.exchange(new Obj(tid * NB_ITERS + i));
+      hazard_retire(old);
+    }
+  }
+}
+
+} // namespace
+
+TEST_CASE("hazard retire") {
+  Obj::created = 0;
+  Obj::deleted = 0;
+
+  std::atomic<Obj *> src{new Obj(1)};
+  HazardPointer hp = make_hazard_pointer();
+  REQUIRE(!hp.empty());
+
+  Obj *obj = hp.protect(src);
+  REQUIRE(obj->id == 1);
+
+  src = new Obj(2);
+  hazard_retire(obj);
+  hazard_cleanup();
+  REQUIRE(Obj::deleted == 0);
+  REQUIRE(obj->check == ~obj->id);
+
+  Obj *other = src.load();
+  REQUIRE(!hp.try_protect(obj, src));
+  REQUIRE(obj == other);
+  hazard_cleanup();
+  REQUIRE(Obj::deleted == 1);
+
+  REQUIRE(hp.try_protect(obj, src));
+  hp = HazardPointer{};
+  REQUIRE(hp.empty());
+  hazard_retire(src.exchange(nullptr));
+  hazard_cleanup();
+  REQUIRE(Obj::deleted == 2);
+}
+
+TEST_CASE("hazard multi protect / retire") {
+  Obj::created = 0;
+  Obj::deleted = 0;
+  g_ptr = new Obj(0);
+
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < NB_THREADS; ++i)
+    ths.emplace_back(runner, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  hazard_retire(g_ptr.exchange(nullptr));
+  hazard_cleanup();
+  REQUIRE(Obj::deleted == Obj::created);
+}
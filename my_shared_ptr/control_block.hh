@@ -1,11 +1,39 @@
 #pragma once
 
+#include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
 
 #include "ref_counter.hh"
 
-class ControlBlock {
+// Counter policy of the control block, and of the pointers using it:
+// - RefCounter: not thread-safe, for objects confined to a thread
+// - AtomicRefCounter: default
+// - BiasedRefCounter: cheap for the thread creating the block, merged on its
+//   owner thread when released by others
+// MY_SHARED_PTR_BIASED: BiasedRefCounter is the default
+#ifdef MY_SHARED_PTR_BIASED
+using DefaultRefCounter = BiasedRefCounter;
+#else
+using DefaultRefCounter = AtomicRefCounter;
+#endif
+
+// Biased blocks are queued to their owner thread
+template <class Counter> struct ControlBlockBase {};
+template <> struct ControlBlockBase<BiasedRefCounter> : BiasedHook {};
+
+template <class Counter = DefaultRefCounter>
+class ControlBlock : public ControlBlockBase<Counter> {
+
+  static constexpr bool IS_BIASED =
+      std::is_same<Counter, BiasedRefCounter>::value;
+
+  // The weak count is only atomic with the shared count
+  using WeakCounter =
+      typename std::conditional<std::is_same<Counter, RefCounter>::value,
+                                RefCounter, AtomicRefCounter>::type;
+
 public:
   ControlBlock() : _shared_count(1), _weak_count(1) {}
 
@@ -13,14 +41,35 @@ public:
 
   void increment_shared() { _shared_count.increment(); }
 
+  void increment_shared(std::size_t n) { _shared_count.increment(n); }
+
   void decrement_shared() {
-    bool dead = _shared_count.decrement();
-    if (dead) {
-      _on_0_shared();
-      decrement_weak();
+    if constexpr (IS_BIASED) {
+      switch (_shared_count.decrement()) {
+      case BiasedRefCounter::DEAD:
+        _release_shared();
+        break;
+      case BiasedRefCounter::QUEUE:
+        _shared_count.owner()->enqueue(this);
+        break;
+      case BiasedRefCounter::ALIVE:
+        break;
+      }
+
+      BiasedOwner::drain_current();
+    } else {
+      bool dead = _shared_count.decrement();
+      if (dead)
+        _release_shared();
     }
   }
 
+  // Overrides BiasedHook::biased_merge, only instantiated for biased blocks
+  void biased_merge() {
+    if (_shared_count.merge())
+      _release_shared();
+  }
+
   void increment_weak() { _weak_count.increment(); }
 
   void decrement_weak() {
@@ -40,36 +89,112 @@ protected:
   virtual void _on_0_weak() = 0;
 
 private:
-  AtomicRefCounter _shared_count;
-  AtomicRefCounter _weak_count;
+  Counter _shared_count;
+  WeakCounter _weak_count;
+
+  void _release_shared() {
+    _on_0_shared();
+    decrement_weak();
+  }
 };
 
-template <class T, class Deleter> class ControledPtr : public ControlBlock {
+// The block is allocated through Alloc, rebound to the block type, like
+// ControledInplace
+template <class T, class Deleter, class Alloc = std::allocator<T>,
+          class Counter = DefaultRefCounter>
+class ControledPtr : public ControlBlock<Counter> {
+
+  using BlockAlloc = typename std::allocator_traits<
+      Alloc>::template rebind_alloc<ControledPtr>;
+  using BlockTraits = std::allocator_traits<BlockAlloc>;
+
+  // Empty base: no space taken by stateless allocators
+  struct Storage : BlockAlloc {
+    Deleter deleter;
+
+    Storage(const BlockAlloc &alloc, Deleter deleter)
+        : BlockAlloc(alloc), deleter(std::move(deleter)) {}
+  };
+
 public:
-  ControledPtr(T *ptr, Deleter deleter)
-      : _ptr(ptr), _deleter(std::move(deleter)) {}
+  ControledPtr(T *ptr, Deleter deleter, const BlockAlloc &alloc)
+      : _ptr(ptr), _storage(alloc, std::move(deleter)) {}
+
+  // ptr is deleted if the block can't be allocated
+  static ControledPtr *create(T *ptr, Deleter deleter, const Alloc &alloc) {
+    BlockAlloc block_alloc(alloc);
+    ControledPtr *res;
+    try {
+      res = BlockTraits::allocate(block_alloc, 1);
+    } catch (...) {
+      deleter(ptr);
+      throw;
+    }
+    ::new (static_cast<void *>(res))
+        ControledPtr(ptr, std::move(deleter), block_alloc);
+    return res;
+  }
 
-  void _on_0_shared() override { _deleter(_ptr); }
+  void _on_0_shared() override { _storage.deleter(_ptr); }
 
-  void _on_0_weak() override { delete this; }
+  void _on_0_weak() override {
+    BlockAlloc alloc(std::move(static_cast<BlockAlloc &>(_storage)));
+    this->~ControledPtr();
+    BlockTraits::deallocate(alloc, this, 1);
+  }
 
 private:
   T *_ptr;
-  Deleter _deleter;
+  Storage _storage;
 };
 
-template <class T> class ControledInplace : public ControlBlock {
+// The block is allocated through Alloc, rebound to the block type
+// A copy of the allocator is stored in the block, and used to free it
+template <class T, class Alloc = std::allocator<T>,
+          class Counter = DefaultRefCounter>
+class ControledInplace : public ControlBlock<Counter> {
+
+  using BlockAlloc = typename std::allocator_traits<
+      Alloc>::template rebind_alloc<ControledInplace>;
+  using BlockTraits = std::allocator_traits<BlockAlloc>;
+
+  // Empty base: no space taken by stateless allocators
+  struct Storage : BlockAlloc {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+
+    Storage(const BlockAlloc &alloc) : BlockAlloc(alloc) {}
+  };
+
 public:
-  template <class... Args> ControledInplace(Args &&... args) {
+  template <class... Args>
+  ControledInplace(const BlockAlloc &alloc, Args &&... args) : _storage(alloc) {
     new (get_ptr()) T(std::forward<Args>(args)...);
   }
 
+  template <class... Args>
+  static ControledInplace *create(const Alloc &alloc, Args &&... args) {
+    BlockAlloc block_alloc(alloc);
+    ControledInplace *res = BlockTraits::allocate(block_alloc, 1);
+    try {
+      ::new (static_cast<void *>(res))
+          ControledInplace(block_alloc, std::forward<Args>(args)...);
+    } catch (...) {
+      BlockTraits::deallocate(block_alloc, res, 1);
+      throw;
+    }
+    return res;
+  }
+
   void _on_0_shared() override { get_ptr()->~T(); }
 
-  void _on_0_weak() override { delete this; }
+  void _on_0_weak() override {
+    BlockAlloc alloc(std::move(static_cast<BlockAlloc &>(_storage)));
+    this->~ControledInplace();
+    BlockTraits::deallocate(alloc, this, 1);
+  }
 
-  T *get_ptr() { return reinterpret_cast<T *>(&_data); }
+  T *get_ptr() { return reinterpret_cast<T *>(&_storage.data); }
 
 private:
-  typename std::aligned_storage<sizeof(T), alignof(T)>::type _data;
+  Storage _storage;
 };
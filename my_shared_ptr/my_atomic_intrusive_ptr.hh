@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "my_intrusive_ptr.hh"
+
+// Lock-free atomic my_intrusive_ptr, split reference counting like
+// my_atomic_shared_ptr<T, LockFree>
+//
+// The pointer, a local count and a tag are updated together with a 16 bytes
+// CAS (cmpxchg16b, requires -mcx16):
+// - local: number of load() in progress on the stored value
+// - tag: incremented every time a new value is stored (avoid ABA)
+// The atomic owns one reference of the stored object. load() increments the
+// local count, which prevents the owned reference from being released, takes
+// its own reference, then gives back its local reference. When a value is
+// replaced, the local count is transfered to the object count, the pending
+// readers see the tag changed and release a reference instead.
+template <class T> class my_atomic_intrusive_ptr {
+
+  struct alignas(16) Word {
+    T *ptr;
+    std::uint32_t local;
+    std::uint32_t tag;
+  };
+
+  using adopt_t = typename my_intrusive_ptr<T>::adopt_t;
+
+public:
+  my_atomic_intrusive_ptr() : _word(Word{nullptr, 0, 0}) {}
+
+  my_atomic_intrusive_ptr(my_intrusive_ptr<T> desired)
+      : _word(Word{desired._detach(), 0, 0}) {}
+
+  my_atomic_intrusive_ptr(const my_atomic_intrusive_ptr &) = delete;
+  my_atomic_intrusive_ptr &operator=(const my_atomic_intrusive_ptr &) = delete;
+
+  ~my_atomic_intrusive_ptr() {
+    _release(_word.load(std::memory_order_acquire));
+  }
+
+  my_intrusive_ptr<T> load() const {
+    // Take a local reference
+    Word w = _word.load(std::memory_order_acquire);
+    for (;;) {
+      if (!w.ptr)
+        return nullptr;
+
+      Word next{w.ptr, w.local + 1, w.tag};
+      if (_word.compare_exchange_weak(w, next, std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+        break;
+    }
+
+    w.ptr->_add_ref();
+    my_intrusive_ptr<T> res(adopt_t{}, w.ptr);
+
+    // Give back the local reference
+    Word cur = _word.load(std::memory_order_relaxed);
+    for (;;) {
+      if (cur.ptr != w.ptr || cur.tag != w.tag) {
+        // Value replaced, the local count was transfered to the object count
+        // Never reaches 0, res holds a reference
+        w.ptr->_release();
+        break;
+      }
+
+      Word next{cur.ptr, cur.local - 1, cur.tag};
+      if (_word.compare_exchange_weak(cur, next, std::memory_order_release,
+                                      std::memory_order_relaxed))
+        break;
+    }
+
+    return res;
+  }
+
+  bool compare_exchange(my_intrusive_ptr<T> &exp, my_intrusive_ptr<T> desired) {
+    Word cur = _word.load(std::memory_order_acquire);
+
+    for (;;) {
+      // Only compare addresses, no need to hold a reference
+      if (cur.ptr != exp.get()) {
+        exp = load();
+        return false;
+      }
+
+      Word next{desired.get(), 0, cur.tag + 1};
+      if (_word.compare_exchange_weak(cur, next, std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+        break;
+    }
+
+    // The reference of desired is now owned by the atomic
+    desired._detach();
+
+    // Release the old value after the swap (avoid freeing on the CAS loop)
+    _release(cur);
+    return true;
+  }
+
+  my_intrusive_ptr<T> exchange(my_intrusive_ptr<T> desired) {
+    Word cur = _word.load(std::memory_order_acquire);
+    Word next;
+    do
+      next = Word{desired.get(), 0, cur.tag + 1};
+    while (!_word.compare_exchange_weak(cur, next, std::memory_order_acq_rel,
+                                        std::memory_order_acquire));
+
+    desired._detach();
+
+    // The owned reference of the old value goes to the result, after the
+    // local count transfer
+    if (cur.ptr && cur.local)
+      cur.ptr->_add_ref(cur.local);
+    return my_intrusive_ptr<T>(adopt_t{}, cur.ptr);
+  }
+
+  operator bool() const {
+    return _word.load(std::memory_order_acquire).ptr != nullptr;
+  }
+
+  // Stored pointer, no reference taken: only usable while something else
+  // keeps the object alive (epoch, hazard pointer, ...)
+  T *peek() const { return _word.load(std::memory_order_acquire).ptr; }
+
+private:
+  // load() updates the local count
+  mutable std::atomic<Word> _word;
+
+  // Transfer the local count, then drop the owned reference
+  static void _release(const Word &w) {
+    if (!w.ptr)
+      return;
+
+    if (w.local)
+      w.ptr->_add_ref(w.local);
+    w.ptr->_release();
+  }
+};
@@ -1,42 +1,242 @@
 #pragma once
 
-#include "my_shared_ptr.hh"
+#include <atomic>
+#include <cstdint>
 
+#include "my_shared_ptr.hh"
 #include "spinlock.hh"
 
-template <class T> class my_atomic_shared_ptr {
+// Lock policy of my_atomic_shared_ptr: no lock, split reference counting
+struct LockFree {};
+
+template <class T, class Lock = LockFree> class my_atomic_shared_ptr;
+
+// Atomic my_shared_ptr protected by a lock (Spinlock, TtasLock, TicketLock,
+// McsLock, std::mutex, ...)
+template <class T, class Lock> class my_atomic_shared_ptr {
 public:
   my_atomic_shared_ptr() = default;
+
+  my_atomic_shared_ptr(my_shared_ptr<T> desired) : _ptr(std::move(desired)) {}
+
   my_atomic_shared_ptr(const my_atomic_shared_ptr &) = delete;
   my_atomic_shared_ptr &operator=(const my_atomic_shared_ptr &) = delete;
 
-  my_shared_ptr<T> load() {
-    _sp.lock();
+  my_shared_ptr<T> load() const {
+    _lock.lock();
     my_shared_ptr<T> res = _ptr;
-    _sp.unlock();
+    _lock.unlock();
     return res;
   }
 
   bool compare_exchange(my_shared_ptr<T> &exp, my_shared_ptr<T> desired) {
     // Swaps used to make sure no refcount is ever decremented while holding the
     // lock (avoid calling free while holding lock)
-    _sp.lock();
+    _lock.lock();
 
     if (_ptr == exp) {
       _ptr.swap(desired);
-      _sp.unlock();
+      _lock.unlock();
       return true;
     }
 
     my_shared_ptr<T> tmp = _ptr;
-    tmp.swap(exp);
-    _sp.unlock();
+    _lock.unlock();
+    exp.swap(tmp);
     return false;
   }
 
-  operator bool() const { return _ptr; }
+  my_shared_ptr<T> exchange(my_shared_ptr<T> desired) {
+    _lock.lock();
+    _ptr.swap(desired);
+    _lock.unlock();
+    return desired;
+  }
+
+  operator bool() const {
+    _lock.lock();
+    bool res = _ptr;
+    _lock.unlock();
+    return res;
+  }
+
+  // Stored pointer, no reference taken: only usable while something else
+  // keeps the object alive (epoch, hazard pointer, ...)
+  T *peek() const {
+    _lock.lock();
+    T *res = _ptr.get();
+    _lock.unlock();
+    return res;
+  }
 
 private:
   my_shared_ptr<T> _ptr;
-  Spinlock _sp;
+  mutable Lock _lock;
+};
+
+// Lock-free atomic my_shared_ptr, using split reference counting
+//
+// The stored pointer and control block are kept together in a double-width
+// word, updated with a 16 bytes CAS (cmpxchg16b, requires -mcx16)
+// Only the low 48 bits of both are used by x86-64 user-space addresses, the
+// high 16 bits are used as:
+// - ptr word: tag, incremented every time a new value is stored (avoid ABA)
+// - cb word: local count, number of load() in progress on the stored value
+//
+// The atomic owns one shared reference of the stored control block
+// load() increments the local count, which prevents the owned reference from
+// being released, then takes its own shared reference, and finally gives back
+// its local reference.
+// When a value is replaced, the local count is transfered to the shared count
+// before releasing the owned reference. The pending readers see the value
+// changed, and release a shared reference instead of their local reference.
+template <class T> class my_atomic_shared_ptr<T, LockFree> {
+
+  struct alignas(16) Word {
+    std::uintptr_t ptr;
+    std::uintptr_t cb;
+  };
+
+  static_assert(sizeof(void *) == 8, "my_atomic_shared_ptr requires 64 bits");
+
+  static constexpr std::uintptr_t ADDR_BITS = 48;
+  static constexpr std::uintptr_t ADDR_MASK =
+      (std::uintptr_t(1) << ADDR_BITS) - 1;
+  static constexpr std::uintptr_t HIGH_ONE = std::uintptr_t(1) << ADDR_BITS;
+
+public:
+  my_atomic_shared_ptr() : _word(Word{0, 0}) {}
+
+  my_atomic_shared_ptr(my_shared_ptr<T> desired)
+      : _word(_make_word(desired, 0)) {
+    desired._ptr = nullptr;
+    desired._cb = nullptr;
+  }
+
+  my_atomic_shared_ptr(const my_atomic_shared_ptr &) = delete;
+  my_atomic_shared_ptr &operator=(const my_atomic_shared_ptr &) = delete;
+
+  ~my_atomic_shared_ptr() { _release(_word.load(std::memory_order_acquire)); }
+
+  my_shared_ptr<T> load() const {
+    using raw_constructor = typename my_shared_ptr<T>::raw_constructor;
+
+    // Take a local reference
+    Word w = _word.load(std::memory_order_acquire);
+    for (;;) {
+      if (!_get_cb(w))
+        return my_shared_ptr<T>(raw_constructor{}, _get_ptr(w), nullptr);
+
+      Word next{w.ptr, w.cb + HIGH_ONE};
+      if (_word.compare_exchange_weak(w, next, std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+        break;
+    }
+
+    ControlBlock<> *cb = _get_cb(w);
+    cb->increment_shared();
+    my_shared_ptr<T> res(raw_constructor{}, _get_ptr(w), cb);
+
+    // Give back the local reference
+    Word cur = _word.load(std::memory_order_relaxed);
+    for (;;) {
+      if (cur.ptr != w.ptr || _get_cb(cur) != cb) {
+        // Value replaced, the local count was transfered to the shared count
+        // Never reaches 0, res holds a reference
+        cb->decrement_shared();
+        break;
+      }
+
+      Word next{cur.ptr, cur.cb - HIGH_ONE};
+      if (_word.compare_exchange_weak(cur, next, std::memory_order_release,
+                                      std::memory_order_relaxed))
+        break;
+    }
+
+    return res;
+  }
+
+  bool compare_exchange(my_shared_ptr<T> &exp, my_shared_ptr<T> desired) {
+    Word cur = _word.load(std::memory_order_acquire);
+
+    for (;;) {
+      // Only compare addresses, no need to hold a reference
+      if (_get_ptr(cur) != exp._ptr || _get_cb(cur) != exp._cb) {
+        exp = load();
+        return false;
+      }
+
+      Word next = _make_word(desired, (cur.ptr >> ADDR_BITS) + 1);
+      if (_word.compare_exchange_weak(cur, next, std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+        break;
+    }
+
+    // The reference of desired is now owned by the atomic
+    desired._ptr = nullptr;
+    desired._cb = nullptr;
+
+    // Release the old value after the swap (avoid freeing on the CAS loop)
+    _release(cur);
+    return true;
+  }
+
+  my_shared_ptr<T> exchange(my_shared_ptr<T> desired) {
+    using raw_constructor = typename my_shared_ptr<T>::raw_constructor;
+
+    Word cur = _word.load(std::memory_order_acquire);
+    Word next;
+    do
+      next = _make_word(desired, (cur.ptr >> ADDR_BITS) + 1);
+    while (!_word.compare_exchange_weak(cur, next, std::memory_order_acq_rel,
+                                        std::memory_order_acquire));
+
+    desired._ptr = nullptr;
+    desired._cb = nullptr;
+
+    // The owned reference of the old value goes to the result, after the
+    // local count transfer
+    ControlBlock<> *cb = _get_cb(cur);
+    std::size_t local_count = cur.cb >> ADDR_BITS;
+    if (cb && local_count)
+      cb->increment_shared(local_count);
+    return my_shared_ptr<T>(raw_constructor{}, _get_ptr(cur), cb);
+  }
+
+  operator bool() const {
+    return _get_ptr(_word.load(std::memory_order_acquire)) != nullptr;
+  }
+
+  // Stored pointer, no reference taken: only usable while something else
+  // keeps the object alive (epoch, hazard pointer, ...)
+  T *peek() const { return _get_ptr(_word.load(std::memory_order_acquire)); }
+
+private:
+  // load() updates the local count
+  mutable std::atomic<Word> _word;
+
+  static T *_get_ptr(const Word &w) {
+    return reinterpret_cast<T *>(w.ptr & ADDR_MASK);
+  }
+
+  static ControlBlock<> *_get_cb(const Word &w) {
+    return reinterpret_cast<ControlBlock<> *>(w.cb & ADDR_MASK);
+  }
+
+  static Word _make_word(const my_shared_ptr<T> &r, std::uintptr_t tag) {
+    return Word{(tag << ADDR_BITS) | reinterpret_cast<std::uintptr_t>(r._ptr),
+                reinterpret_cast<std::uintptr_t>(r._cb)};
+  }
+
+  // Transfer the local count, then drop the owned reference
+  static void _release(const Word &w) {
+    ControlBlock<> *cb = _get_cb(w);
+    if (!cb)
+      return;
+
+    std::size_t local_count = w.cb >> ADDR_BITS;
+    if (local_count)
+      cb->increment_shared(local_count);
+    cb->decrement_shared();
+  }
 };
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "ref_counter.hh"
+
+template <class T> class my_intrusive_ptr;
+template <class T> class my_atomic_intrusive_ptr;
+
+// Reference count embedded in the object, base of the types pointed by
+// my_intrusive_ptr: no control block, a pointer is a single word
+//
+// Counter: RefCounter (single thread) or AtomicRefCounter
+// The object is destroyed by Derived::intrusive_destroy when the count drops
+// to 0: delete by default, Derived can hide it (allocators, pools)
+template <class Derived, class Counter = AtomicRefCounter>
+class my_intrusive_base {
+public:
+  std::size_t use_count() const { return _count.count(); }
+
+  static void intrusive_destroy(Derived *ptr) { delete ptr; }
+
+protected:
+  my_intrusive_base() : _count(0) {}
+
+  // Copies are new objects, not referenced yet
+  my_intrusive_base(const my_intrusive_base &) : _count(0) {}
+  my_intrusive_base &operator=(const my_intrusive_base &) { return *this; }
+
+  ~my_intrusive_base() = default;
+
+private:
+  mutable Counter _count;
+
+  void _add_ref(std::size_t n = 1) const { _count.increment(n); }
+
+  // Fails once the count dropped to 0
+  bool _try_add_ref() const { return _count.lock(); }
+
+  void _release() const {
+    if (_count.decrement())
+      Derived::intrusive_destroy(
+          static_cast<Derived *>(const_cast<my_intrusive_base *>(this)));
+  }
+
+  template <class Y> friend class my_intrusive_ptr;
+  template <class Y> friend class my_atomic_intrusive_ptr;
+};
+
+// Shared pointer to an object deriving from my_intrusive_base
+template <class T> class my_intrusive_ptr {
+
+  template <class Y> friend class my_intrusive_ptr;
+  template <class Y> friend class my_atomic_intrusive_ptr;
+
+  struct adopt_t {};
+
+public:
+  using element_type = T;
+
+  my_intrusive_ptr() : _ptr(nullptr) {}
+
+  my_intrusive_ptr(std::nullptr_t) : _ptr(nullptr) {}
+
+  // Takes a new reference, ptr may already be owned by other pointers
+  template <class Y>
+  explicit my_intrusive_ptr(
+      Y *ptr,
+      typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
+      : _ptr(ptr) {
+    if (_ptr)
+      _ptr->_add_ref();
+  }
+
+  my_intrusive_ptr(const my_intrusive_ptr &r) : my_intrusive_ptr(r._ptr) {}
+
+  template <class Y>
+  my_intrusive_ptr(
+      const my_intrusive_ptr<Y> &r,
+      typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
+      : my_intrusive_ptr(r._ptr) {}
+
+  my_intrusive_ptr(my_intrusive_ptr &&r) : _ptr(r._ptr) { r._ptr = nullptr; }
+
+  template <class Y>
+  my_intrusive_ptr(
+      my_intrusive_ptr<Y> &&r,
+      typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
+      : _ptr(r._ptr) {
+    r._ptr = nullptr;
+  }
+
+  ~my_intrusive_ptr() {
+    if (_ptr)
+      _ptr->_release();
+  }
+
+  my_intrusive_ptr &operator=(const my_intrusive_ptr &r) {
+    my_intrusive_ptr{r}.swap(*this);
+    return *this;
+  }
+
+  template <class Y> my_intrusive_ptr &operator=(const my_intrusive_ptr<Y> &r) {
+    my_intrusive_ptr{r}.swap(*this);
+    return *this;
+  }
+
+  my_intrusive_ptr &operator=(my_intrusive_ptr &&r) {
+    my_intrusive_ptr{std::move(r)}.swap(*this);
+    return *this;
+  }
+
+  template <class Y> my_intrusive_ptr &operator=(my_intrusive_ptr<Y> &&r) {
+    my_intrusive_ptr{std::move(r)}.swap(*this);
+    return *this;
+  }
+
+  void reset() { my_intrusive_ptr{}.swap(*this); }
+
+  template <class Y> void reset(Y *ptr) { my_intrusive_ptr{ptr}.swap(*this); }
+
+  void swap(my_intrusive_ptr &r) { std::swap(_ptr, r._ptr); }
+
+  T *get() const { return _ptr; }
+  T &operator*() const { return *get(); }
+  T *operator->() const { return get(); }
+
+  std::size_t use_count() const { return _ptr ? _ptr->use_count() : 0; }
+
+  operator bool() const { return get() != nullptr; }
+
+  // Reference to an object whose destruction may be deferred
+  // (intrusive_destroy), empty if the count already dropped to 0
+  static my_intrusive_ptr lock(T *ptr) {
+    if (!ptr || !ptr->_try_add_ref())
+      return nullptr;
+    return my_intrusive_ptr(adopt_t{}, ptr);
+  }
+
+private:
+  T *_ptr;
+
+  // Owns a reference already taken
+  my_intrusive_ptr(const adopt_t &, T *ptr) : _ptr(ptr) {}
+
+  // Gives up the reference without releasing it
+  T *_detach() {
+    T *res = _ptr;
+    _ptr = nullptr;
+    return res;
+  }
+};
+
+template <class T, class U>
+bool operator==(const my_intrusive_ptr<T> &r1, const my_intrusive_ptr<U> &r2) {
+  return r1.get() == r2.get();
+}
+
+template <class T, class U>
+bool operator!=(const my_intrusive_ptr<T> &r1, const my_intrusive_ptr<U> &r2) {
+  return !(r1 == r2);
+}
+
+template <class T>
+bool operator==(const my_intrusive_ptr<T> &r1, std::nullptr_t) {
+  return !r1;
+}
+
+template <class T>
+bool operator!=(const my_intrusive_ptr<T> &r1, std::nullptr_t) {
+  return !(r1 == nullptr);
+}
+
+template <class T>
+bool operator==(std::nullptr_t, const my_intrusive_ptr<T> &r1) {
+  return r1 == nullptr;
+}
+
+template <class T>
+bool operator!=(std::nullptr_t, const my_intrusive_ptr<T> &r1) {
+  return !(r1 == nullptr);
+}
+
+template <class T, class... Args>
+my_intrusive_ptr<T> make_my_intrusive(Args &&... args) {
+  return my_intrusive_ptr<T>(new T(std::forward<Args>(args)...));
+}
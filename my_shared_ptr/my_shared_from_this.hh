@@ -3,9 +3,9 @@
 #include "my_shared_ptr.hh"
 #include "my_weak_ptr.hh"
 
-template <class T> class enable_my_shared_from_this {
+template <class T, class Counter> class enable_my_shared_from_this {
 
-  friend class my_shared_ptr<T>;
+  friend class my_shared_ptr<T, Counter>;
 
 public:
   enable_my_shared_from_this() {}
@@ -15,12 +15,20 @@ public:
     return *this;
   }
 
-  my_shared_ptr<T> shared_from_this() { return my_shared_ptr<T>{_this_weak}; }
+  my_shared_ptr<T, Counter> shared_from_this() {
+    return my_shared_ptr<T, Counter>{_this_weak};
+  }
 
-  my_shared_ptr<const T> shared_from_this() const {
-    return my_shared_ptr<const T>{_this_weak};
+  my_shared_ptr<const T, Counter> shared_from_this() const {
+    return my_shared_ptr<const T, Counter>{_this_weak};
   }
 
+  // Its lock() fails once the last my_shared_ptr is released, even if the
+  // object isn't destroyed yet (deferred deleter)
+  my_weak_ptr<T, Counter> weak_from_this() { return _this_weak; }
+
+  my_weak_ptr<const T, Counter> weak_from_this() const { return _this_weak; }
+
 private:
-  my_weak_ptr<T> _this_weak;
+  my_weak_ptr<T, Counter> _this_weak;
 };
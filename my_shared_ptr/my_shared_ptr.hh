@@ -6,16 +6,13 @@
 #include <type_traits>
 #include <utility>
 
-#include "control_block.hh"
+#include "my_shared_ptr_fwd.hh"
 
-template <class T> class my_shared_ptr;
-template <class T> class my_weak_ptr;
-template <class T> class enable_my_shared_from_this;
+template <class T, class Counter> class my_shared_ptr {
 
-template <class T> class my_shared_ptr {
-
-  template <class Y> friend class my_shared_ptr;
-  template <class Y> friend class my_weak_ptr;
+  template <class Y, class C> friend class my_shared_ptr;
+  template <class Y, class C> friend class my_weak_ptr;
+  template <class Y, class Lock> friend class my_atomic_shared_ptr;
 
   struct raw_constructor {};
 
@@ -37,23 +34,32 @@ public:
   my_shared_ptr(
       Y *ptr, Deleter deleter,
       typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
+      : my_shared_ptr(ptr, std::move(deleter), std::allocator<Y>{}) {}
+
+  // The control block is allocated through a copy of alloc (rebound), kept in
+  // the block to free it
+  template <class Y, class Deleter, class Alloc>
+  my_shared_ptr(
+      Y *ptr, Deleter deleter, const Alloc &alloc,
+      typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
       : my_shared_ptr(raw_constructor{}, ptr,
-                      new ControledPtr<Y, Deleter>(ptr, std::move(deleter))) {
+                      ControledPtr<Y, Deleter, Alloc, Counter>::create(
+                          ptr, std::move(deleter), alloc)) {
 
-    constexpr bool has_weak_this =
-        std::is_convertible<T *, enable_my_shared_from_this<T> *>::value;
+    constexpr bool has_weak_this = std::is_convertible<
+        T *, enable_my_shared_from_this<T, Counter> *>::value;
     _build_weak_this<has_weak_this>();
   }
 
   template <class Y>
-  my_shared_ptr(const my_shared_ptr<Y> &r, T *ptr)
+  my_shared_ptr(const my_shared_ptr<Y, Counter> &r, T *ptr)
       : my_shared_ptr(raw_constructor{}, ptr, r._cb) {
     if (_cb)
       _cb->increment_shared();
   }
 
   template <class Y>
-  my_shared_ptr(my_shared_ptr<Y> &&r, T *ptr)
+  my_shared_ptr(my_shared_ptr<Y, Counter> &&r, T *ptr)
       : my_shared_ptr(raw_constructor{}, ptr, r._cb) {
     r._ptr = nullptr;
     r._cb = nullptr;
@@ -62,7 +68,8 @@ public:
   my_shared_ptr(const my_shared_ptr &r) : my_shared_ptr(r, r._ptr) {}
 
   template <class Y>
-  my_shared_ptr(const my_shared_ptr<Y> &r) : my_shared_ptr(r, r._ptr) {}
+  my_shared_ptr(const my_shared_ptr<Y, Counter> &r)
+      : my_shared_ptr(r, r._ptr) {}
 
   my_shared_ptr(my_shared_ptr &&r)
       : my_shared_ptr(raw_constructor{}, r._ptr, r._cb) {
@@ -72,7 +79,7 @@ public:
 
   template <class Y>
   my_shared_ptr(
-      my_shared_ptr<Y> &&r,
+      my_shared_ptr<Y, Counter> &&r,
       typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
       : my_shared_ptr(raw_constructor{}, r._ptr, r._cb) {
     r._ptr = nullptr;
@@ -81,7 +88,7 @@ public:
 
   template <class Y>
   explicit my_shared_ptr(
-      const my_weak_ptr<Y> &r,
+      const my_weak_ptr<Y, Counter> &r,
       typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
       : my_shared_ptr(raw_constructor{}, r._ptr,
                       r._cb && r._cb->lock() ? r._cb : nullptr) {
@@ -100,7 +107,8 @@ public:
     return *this;
   }
 
-  template <class Y> my_shared_ptr &operator=(const my_shared_ptr<Y> &r) {
+  template <class Y>
+  my_shared_ptr &operator=(const my_shared_ptr<Y, Counter> &r) {
     my_shared_ptr{r}.swap(*this);
     return *this;
   }
@@ -110,7 +118,7 @@ public:
     return *this;
   }
 
-  template <class Y> my_shared_ptr &operator=(my_shared_ptr<Y> &&r) {
+  template <class Y> my_shared_ptr &operator=(my_shared_ptr<Y, Counter> &&r) {
     my_shared_ptr{std::move(r)}.swap(*this);
     return *this;
   }
@@ -146,17 +154,26 @@ public:
 
   operator bool() const { return get() != nullptr; }
 
-  template <class Y> bool owner_before(const my_shared_ptr<Y> &other) const {
+  template <class Y>
+  bool owner_before(const my_shared_ptr<Y, Counter> &other) const {
     return _cb < other._cb;
   }
 
   template <class... Args>
   static my_shared_ptr wrapper_make_shared(Args &&... args) {
-    auto ctrl = new ControledInplace<T>(std::forward<Args>(args)...);
+    return wrapper_allocate_shared(std::allocator<T>{},
+                                   std::forward<Args>(args)...);
+  }
+
+  template <class Alloc, class... Args>
+  static my_shared_ptr wrapper_allocate_shared(const Alloc &alloc,
+                                               Args &&... args) {
+    auto ctrl = ControledInplace<T, Alloc, Counter>::create(
+        alloc, std::forward<Args>(args)...);
     auto res = my_shared_ptr{raw_constructor(), ctrl->get_ptr(), ctrl};
 
-    constexpr bool has_weak_this =
-        std::is_convertible<T *, enable_my_shared_from_this<T> *>::value;
+    constexpr bool has_weak_this = std::is_convertible<
+        T *, enable_my_shared_from_this<T, Counter> *>::value;
 
     res.template _build_weak_this<has_weak_this>();
     return res;
@@ -168,9 +185,9 @@ public:
 
 private:
   T *_ptr;
-  ControlBlock *_cb;
+  ControlBlock<Counter> *_cb;
 
-  my_shared_ptr(const raw_constructor &, T *ptr, ControlBlock *cb)
+  my_shared_ptr(const raw_constructor &, T *ptr, ControlBlock<Counter> *cb)
       : _ptr(ptr), _cb(cb) {}
 
   template <bool has_weak_this> void _build_weak_this() {}
@@ -179,34 +196,40 @@ private:
     if (!use_count())
       return;
 
-    auto ptr = static_cast<enable_my_shared_from_this<T> *>(_ptr);
-    ptr->_this_weak = my_shared_ptr<T>(*this);
+    auto ptr = static_cast<enable_my_shared_from_this<T, Counter> *>(_ptr);
+    ptr->_this_weak = *this;
   }
 };
 
-template <class T, class U>
-bool operator==(const my_shared_ptr<T> &r1, const my_shared_ptr<U> &r2) {
+template <class T, class U, class Counter>
+bool operator==(const my_shared_ptr<T, Counter> &r1,
+                const my_shared_ptr<U, Counter> &r2) {
   return r1.get() == r2.get();
 }
 
-template <class T, class U>
-bool operator!=(const my_shared_ptr<T> &r1, const my_shared_ptr<U> &r2) {
+template <class T, class U, class Counter>
+bool operator!=(const my_shared_ptr<T, Counter> &r1,
+                const my_shared_ptr<U, Counter> &r2) {
   return !(r1 == r2);
 }
 
-template <class T> bool operator==(const my_shared_ptr<T> &r1, std::nullptr_t) {
+template <class T, class Counter>
+bool operator==(const my_shared_ptr<T, Counter> &r1, std::nullptr_t) {
   return !r1;
 }
 
-template <class T> bool operator!=(const my_shared_ptr<T> &r1, std::nullptr_t) {
+template <class T, class Counter>
+bool operator!=(const my_shared_ptr<T, Counter> &r1, std::nullptr_t) {
   return !(r1 == nullptr);
 }
 
-template <class T> bool operator==(std::nullptr_t, const my_shared_ptr<T> &r1) {
+template <class T, class Counter>
+bool operator==(std::nullptr_t, const my_shared_ptr<T, Counter> &r1) {
   return r1 == nullptr;
 }
 
-template <class T> bool operator!=(std::nullptr_t, const my_shared_ptr<T> &r1) {
+template <class T, class Counter>
+bool operator!=(std::nullptr_t, const my_shared_ptr<T, Counter> &r1) {
   return !(r1 == nullptr);
 }
 
@@ -214,3 +237,22 @@ template <class T, class... Args>
 my_shared_ptr<T> make_my_shared(Args &&... args) {
   return my_shared_ptr<T>::wrapper_make_shared(std::forward<Args>(args)...);
 }
+
+// Object and control block in a single allocation, done through a copy of
+// alloc (rebound), kept in the control block to free it
+template <class T, class Alloc, class... Args>
+my_shared_ptr<T> allocate_my_shared(const Alloc &alloc, Args &&... args) {
+  return my_shared_ptr<T>::wrapper_allocate_shared(alloc,
+                                                   std::forward<Args>(args)...);
+}
+
+// Not thread-safe reference counting, for objects that never leave their thread
+// No atomic instruction on copy / destruction
+template <class T> using my_local_shared_ptr = my_shared_ptr<T, RefCounter>;
+template <class T> using my_local_weak_ptr = my_weak_ptr<T, RefCounter>;
+
+template <class T, class... Args>
+my_local_shared_ptr<T> make_my_local_shared(Args &&... args) {
+  return my_local_shared_ptr<T>::wrapper_make_shared(
+      std::forward<Args>(args)...);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "control_block.hh"
+
+// Counter: reference counter policy of the control block (control_block.hh)
+template <class T, class Counter = DefaultRefCounter> class my_shared_ptr;
+template <class T, class Counter = DefaultRefCounter> class my_weak_ptr;
+template <class T, class Counter = DefaultRefCounter>
+class enable_my_shared_from_this;
+template <class T, class Lock> class my_atomic_shared_ptr;
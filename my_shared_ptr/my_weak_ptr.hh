@@ -6,15 +6,12 @@
 #include <type_traits>
 #include <utility>
 
-#include "control_block.hh"
+#include "my_shared_ptr_fwd.hh"
 
-template <class T> class my_shared_ptr;
-template <class T> class my_weak_ptr;
+template <class T, class Counter> class my_weak_ptr {
 
-template <class T> class my_weak_ptr {
-
-  template <class Y> friend class my_shared_ptr;
-  template <class Y> friend class my_weak_ptr;
+  template <class Y, class C> friend class my_shared_ptr;
+  template <class Y, class C> friend class my_weak_ptr;
 
   using element_type = T;
 
@@ -28,7 +25,7 @@ public:
 
   template <class Y>
   my_weak_ptr(
-      const my_weak_ptr<Y> &r,
+      const my_weak_ptr<Y, Counter> &r,
       typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
       : my_weak_ptr(r._ptr, r._cb) {
     if (_cb)
@@ -37,7 +34,7 @@ public:
 
   template <class Y>
   my_weak_ptr(
-      const my_shared_ptr<Y> &r,
+      const my_shared_ptr<Y, Counter> &r,
       typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
       : my_weak_ptr(r._ptr, r._cb) {
     if (_cb)
@@ -51,7 +48,7 @@ public:
 
   template <class Y>
   my_weak_ptr(
-      my_weak_ptr<Y> &&r,
+      my_weak_ptr<Y, Counter> &&r,
       typename std::enable_if<std::is_convertible<Y *, T *>::value>::type * = 0)
       : my_weak_ptr(r._ptr, r._cb) {
     r._ptr = nullptr;
@@ -68,12 +65,13 @@ public:
     return *this;
   }
 
-  template <class Y> my_weak_ptr &operator=(const my_weak_ptr<Y> &t) {
+  template <class Y> my_weak_ptr &operator=(const my_weak_ptr<Y, Counter> &t) {
     my_weak_ptr{t}.swap(*this);
     return *this;
   }
 
-  template <class Y> my_weak_ptr &operator=(const my_shared_ptr<Y> &t) {
+  template <class Y>
+  my_weak_ptr &operator=(const my_shared_ptr<Y, Counter> &t) {
     my_weak_ptr{t}.swap(*this);
     return *this;
   }
@@ -83,7 +81,7 @@ public:
     return *this;
   }
 
-  template <class Y> my_weak_ptr &operator=(my_weak_ptr<Y> &&t) {
+  template <class Y> my_weak_ptr &operator=(my_weak_ptr<Y, Counter> &&t) {
     my_weak_ptr{std::move(t)}.swap(*this);
     return *this;
   }
@@ -99,15 +97,16 @@ public:
     std::swap(_cb, r._cb);
   }
 
-  my_shared_ptr<T> lock() const {
-    using raw_constructor = typename my_shared_ptr<T>::raw_constructor;
+  my_shared_ptr<T, Counter> lock() const {
+    using shared_ptr = my_shared_ptr<T, Counter>;
+    using raw_constructor = typename shared_ptr::raw_constructor;
     auto ctrl = _cb && _cb->lock() ? _cb : nullptr;
-    return my_shared_ptr<T>(raw_constructor{}, ctrl ? _ptr : nullptr, ctrl);
+    return shared_ptr(raw_constructor{}, ctrl ? _ptr : nullptr, ctrl);
   }
 
 private:
   T *_ptr;
-  ControlBlock *_cb;
+  ControlBlock<Counter> *_cb;
 
-  my_weak_ptr(T *ptr, ControlBlock *cb) : _ptr(ptr), _cb(cb) {}
+  my_weak_ptr(T *ptr, ControlBlock<Counter> *cb) : _ptr(ptr), _cb(cb) {}
 };
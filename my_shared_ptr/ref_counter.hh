@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 
 class RefCounter {
 public:
@@ -12,6 +13,8 @@ public:
 
   void increment() { ++_val; }
 
+  void increment(std::size_t n) { _val += n; }
+
   bool decrement() { return --_val == 0; }
 
   bool lock() {
@@ -34,6 +37,10 @@ public:
 
   void increment() { _val.fetch_add(1, std::memory_order_relaxed); }
 
+  void increment(std::size_t n) {
+    _val.fetch_add(n, std::memory_order_relaxed);
+  }
+
   bool decrement() { return _val.fetch_sub(1, std::memory_order_acq_rel) == 1; }
 
   bool lock() {
@@ -56,3 +63,255 @@ public:
 private:
   std::atomic<std::size_t> _val;
 };
+
+class BiasedOwner;
+
+// Queued to the owner thread of a BiasedRefCounter, base of the ControlBlock
+// in biased mode
+class BiasedHook {
+public:
+  BiasedHook() : _biased_next(nullptr) {}
+  virtual ~BiasedHook() = default;
+
+  // Merge the biased count into the shared count
+  virtual void biased_merge() = 0;
+
+private:
+  BiasedHook *_biased_next;
+
+  friend class BiasedOwner;
+};
+
+// Thread owning biased counters, created by the first counter of the thread
+//
+// Holds the queue of counters its thread must merge, drained by the thread on
+// its next decrement, or by the thread queueing once the owner exited.
+// Freed when the thread exited and all its counters are merged.
+class BiasedOwner {
+public:
+  BiasedOwner(const BiasedOwner &) = delete;
+  BiasedOwner &operator=(const BiasedOwner &) = delete;
+
+  // Record of the calling thread, nullptr if it has none
+  static BiasedOwner *current() { return _current(); }
+
+  // Record of the calling thread, created if needed
+  // nullptr once the thread exits: counters created then start merged
+  static BiasedOwner *acquire() {
+    BiasedOwner *&cur = _current();
+    if (!cur && !_exited()) {
+      cur = new BiasedOwner;
+      thread_local ExitGuard guard;
+    }
+    if (cur)
+      cur->_refs.fetch_add(1, std::memory_order_relaxed);
+    return cur;
+  }
+
+  // A counter owned by this thread is merged
+  void release() {
+    if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+  // Any thread
+  void enqueue(BiasedHook *hook) {
+    // The hook may be drained by another thread right after the push
+    _refs.fetch_add(1, std::memory_order_relaxed);
+
+    hook->_biased_next = _queue.load(std::memory_order_relaxed);
+    while (!_queue.compare_exchange_weak(hook->_biased_next, hook,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+      continue;
+
+    // Owner gone: the biased counts can't change anymore, merge them here
+    if (!_alive.load(std::memory_order_seq_cst))
+      _drain();
+
+    release();
+  }
+
+  // Merge the counters queued to the calling thread
+  static void drain_current() {
+    BiasedOwner *cur = _current();
+    if (cur && cur->_queue.load(std::memory_order_relaxed))
+      cur->_drain();
+  }
+
+private:
+  // 1 for the thread, 1 for each counter not merged yet
+  std::atomic<std::size_t> _refs;
+  std::atomic<bool> _alive;
+  std::atomic<BiasedHook *> _queue;
+
+  BiasedOwner() : _refs(1), _alive(true), _queue(nullptr) {}
+
+  struct ExitGuard {
+    ~ExitGuard() {
+      BiasedOwner *cur = _current();
+      _current() = nullptr;
+      _exited() = true;
+
+      cur->_alive.store(false, std::memory_order_seq_cst);
+      cur->_drain();
+      cur->release();
+    }
+  };
+
+  // Trivial thread_locals, still usable during the exit of the thread
+  static BiasedOwner *&_current() {
+    thread_local BiasedOwner *res = nullptr;
+    return res;
+  }
+
+  static bool &_exited() {
+    thread_local bool res = false;
+    return res;
+  }
+
+  // Merges may free control blocks, and queue other hooks: works on a
+  // detached list, until the queue is empty
+  void _drain() {
+    while (BiasedHook *hook =
+               _queue.exchange(nullptr, std::memory_order_seq_cst)) {
+      while (hook) {
+        BiasedHook *next = hook->_biased_next;
+        hook->biased_merge();
+        hook = next;
+      }
+    }
+  }
+};
+
+// Biased reference counter (Choi, Shull, Torrellas, 2018)
+//
+// The thread creating the counter owns it, and counts in _biased with plain
+// loads / stores. Other threads count in _shared, atomically, it may go below
+// 0 when they release references the owner counted.
+// _shared: count << 2 | QUEUED | MERGED
+// - When the owner count drops to 0, the owner merges: sets MERGED, from then
+//   on every thread only uses _shared
+// - A thread taking _shared below 0 before the merge sets QUEUED, and hands the
+//   counter to its owner (decrement returns QUEUE). The owner then merges the
+//   biased count explicitly, the counter can't die while QUEUED.
+// Until the merge, a counter whose references were all released stays alive.
+// The counter keeps its owner record alive until it's merged and not queued.
+class BiasedRefCounter {
+public:
+  enum Release { ALIVE, DEAD, QUEUE };
+
+  BiasedRefCounter(std::size_t init)
+      : _owner(BiasedOwner::acquire()), _biased(_owner ? init : 0),
+        _shared(_owner ? 0 : static_cast<std::int64_t>(init) * ONE | MERGED) {}
+
+  BiasedRefCounter(const BiasedRefCounter &) = delete;
+
+  // Approximate outside of the owner thread
+  std::size_t count() const {
+    std::int64_t res = _count(_shared.load(std::memory_order_relaxed)) +
+                       static_cast<std::int64_t>(
+                           _biased.load(std::memory_order_relaxed));
+    return res > 0 ? static_cast<std::size_t>(res) : 0;
+  }
+
+  BiasedOwner *owner() const { return _owner; }
+
+  void increment() { increment(1); }
+
+  void increment(std::size_t n) {
+    if (_is_owner())
+      _biased.store(_biased.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+    else
+      _shared.fetch_add(static_cast<std::int64_t>(n) * ONE,
+                        std::memory_order_relaxed);
+  }
+
+  Release decrement() {
+    if (_is_owner()) {
+      std::size_t biased = _biased.load(std::memory_order_relaxed) - 1;
+      _biased.store(biased, std::memory_order_relaxed);
+      if (biased)
+        return ALIVE;
+
+      // Implicit merge, a queued counter is released by the explicit one
+      // Other threads may free the counter right after the merge
+      BiasedOwner *owner = _owner;
+      std::int64_t old = _shared.fetch_add(MERGED, std::memory_order_acq_rel);
+      if (old & QUEUED)
+        return ALIVE;
+
+      owner->release();
+      return _count(old) == 0 ? DEAD : ALIVE;
+    }
+
+    std::int64_t old = _shared.load(std::memory_order_relaxed);
+    std::int64_t next;
+    do {
+      next = old - ONE;
+      if (!(old & (MERGED | QUEUED)) && _count(next) < 0)
+        next |= QUEUED;
+    } while (!_shared.compare_exchange_weak(old, next,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed));
+
+    if ((next & QUEUED) && !(old & QUEUED))
+      return QUEUE;
+    return (next & MERGED) && !(next & QUEUED) && _count(next) == 0 ? DEAD
+                                                                     : ALIVE;
+  }
+
+  // Queued counter, by the owner thread or once it exited
+  // Returns true if the count dropped to 0
+  bool merge() {
+    // MERGED is only set by the owner, or once it exited
+    std::int64_t flags = MERGED - QUEUED;
+    if (_shared.load(std::memory_order_relaxed) & MERGED)
+      flags = -QUEUED;
+
+    auto biased =
+        static_cast<std::int64_t>(_biased.load(std::memory_order_relaxed));
+    _biased.store(0, std::memory_order_relaxed);
+
+    BiasedOwner *owner = _owner;
+    std::int64_t old = _shared.fetch_add(biased * ONE + flags,
+                                         std::memory_order_acq_rel);
+    owner->release();
+    return _count(old) + biased == 0;
+  }
+
+  bool lock() {
+    if (_is_owner()) {
+      increment();
+      return true;
+    }
+
+    std::int64_t count = _shared.load(std::memory_order_relaxed);
+    while (!(count & MERGED) || _count(count) > 0)
+      if (_shared.compare_exchange_weak(count, count + ONE,
+                                        std::memory_order_relaxed,
+                                        std::memory_order_relaxed))
+        return true;
+
+    return false;
+  }
+
+private:
+  static constexpr std::int64_t MERGED = 1;
+  static constexpr std::int64_t QUEUED = 2;
+  static constexpr std::int64_t ONE = 4;
+
+  // nullptr: created during the exit of its thread, starts merged
+  BiasedOwner *const _owner;
+  std::atomic<std::size_t> _biased;
+  std::atomic<std::int64_t> _shared;
+
+  static std::int64_t _count(std::int64_t shared) { return shared >> 2; }
+
+  // Once merged, the owner count stays 0
+  bool _is_owner() const {
+    return _owner && _owner == BiasedOwner::current() &&
+           _biased.load(std::memory_order_relaxed);
+  }
+};
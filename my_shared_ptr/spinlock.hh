@@ -1,7 +1,44 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <thread>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Spin-wait hint: lets the sibling hyperthread run, and avoids the memory
+// order violation penalty when the awaited value changes
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#endif
+}
+
+// Spin, then give up the CPU: a waiter may be spinning for a preempted holder
+class SpinWait {
+public:
+  SpinWait() : _count(0) {}
+
+  void wait(std::size_t pauses = 1) {
+    if (_count < SPIN_LIMIT) {
+      _count += pauses;
+      for (std::size_t i = 0; i < pauses; ++i)
+        cpu_relax();
+    } else
+      std::this_thread::yield();
+  }
+
+private:
+  static constexpr std::size_t SPIN_LIMIT = 512;
+
+  std::size_t _count;
+};
+
+// Test-and-set: every spin iteration is a write, the cache line bounces
+// between all waiters
 class Spinlock {
 public:
   Spinlock() : _lock(0) {}
@@ -16,3 +53,168 @@ public:
 private:
   std::atomic_flag _lock;
 };
+
+// Test-and-test-and-set, with exponential backoff
+// Waiters spin on a shared read of the line, and only try the exchange once
+// the lock looks free
+class TtasLock {
+public:
+  TtasLock() : _locked(false) {}
+
+  void lock() {
+    std::size_t backoff = MIN_BACKOFF;
+    SpinWait spin;
+
+    while (_locked.exchange(true, std::memory_order_acquire)) {
+      do {
+        spin.wait(backoff);
+        backoff = std::min(backoff * 2, MAX_BACKOFF);
+      } while (_locked.load(std::memory_order_relaxed));
+    }
+  }
+
+  bool try_lock() {
+    return !_locked.load(std::memory_order_relaxed) &&
+           !_locked.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() { _locked.store(false, std::memory_order_release); }
+
+private:
+  static constexpr std::size_t MIN_BACKOFF = 4;
+  static constexpr std::size_t MAX_BACKOFF = 1024;
+
+  std::atomic<bool> _locked;
+};
+
+// FIFO: each thread takes a ticket, and waits for its turn
+// Backoff proportional to the number of threads ahead
+class TicketLock {
+public:
+  TicketLock() : _next(0), _serving(0) {}
+
+  void lock() {
+    std::size_t ticket = _next.fetch_add(1, std::memory_order_relaxed);
+    SpinWait spin;
+
+    for (;;) {
+      std::size_t serving = _serving.load(std::memory_order_acquire);
+      if (serving == ticket)
+        return;
+
+      spin.wait((ticket - serving) * BACKOFF_UNIT);
+    }
+  }
+
+  void unlock() {
+    // Only the holder writes it
+    std::size_t serving = _serving.load(std::memory_order_relaxed);
+    _serving.store(serving + 1, std::memory_order_release);
+  }
+
+private:
+  static constexpr std::size_t BACKOFF_UNIT = 16;
+
+  alignas(64) std::atomic<std::size_t> _next;
+  alignas(64) std::atomic<std::size_t> _serving;
+};
+
+// MCS queue lock (Mellor-Crummey, Scott): FIFO, each waiter spins on its own
+// queue node, and the holder hands the lock over to the next one
+//
+// Queue nodes come from a thread-local free list, the node of the holder is
+// kept in the lock: lock() / unlock() need no argument.
+class McsLock {
+
+  struct alignas(64) QNode {
+    std::atomic<QNode *> next;
+    std::atomic<bool> locked;
+    QNode *free_next;
+  };
+
+  // Free nodes of a thread, deleted when it exits
+  class NodeCache {
+  public:
+    NodeCache() : _free(nullptr) {}
+
+    ~NodeCache() {
+      while (_free) {
+        QNode *next = _free->free_next;
+        delete _free;
+        _free = next;
+      }
+    }
+
+    QNode *get() {
+      if (!_free)
+        return new QNode;
+
+      QNode *res = _free;
+      _free = res->free_next;
+      return res;
+    }
+
+    void put(QNode *node) {
+      node->free_next = _free;
+      _free = node;
+    }
+
+  private:
+    QNode *_free;
+  };
+
+  static NodeCache &_cache() {
+    thread_local NodeCache res;
+    return res;
+  }
+
+public:
+  McsLock() : _tail(nullptr), _holder(nullptr) {}
+
+  McsLock(const McsLock &) = delete;
+  McsLock &operator=(const McsLock &) = delete;
+
+  void lock() {
+    QNode *node = _cache().get();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->locked.store(true, std::memory_order_relaxed);
+
+    QNode *prev = _tail.exchange(node, std::memory_order_acq_rel);
+    if (prev) {
+      prev->next.store(node, std::memory_order_release);
+      SpinWait spin;
+      while (node->locked.load(std::memory_order_acquire))
+        spin.wait();
+    }
+
+    // Only read by the holder
+    _holder = node;
+  }
+
+  void unlock() {
+    QNode *node = _holder;
+    QNode *next = node->next.load(std::memory_order_acquire);
+
+    if (!next) {
+      QNode *expected = node;
+      if (_tail.compare_exchange_strong(expected, nullptr,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+        _cache().put(node);
+        return;
+      }
+
+      // A thread is enqueuing, wait for it to link itself
+      SpinWait spin;
+      while (!(next = node->next.load(std::memory_order_acquire)))
+        spin.wait();
+    }
+
+    next->locked.store(false, std::memory_order_release);
+    _cache().put(node);
+  }
+
+private:
+  alignas(64) std::atomic<QNode *> _tail;
+  QNode *_holder;
+};
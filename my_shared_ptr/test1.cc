@@ -17,6 +17,27 @@ struct Child : public Base {
   Child(int x, int y) : Base(x), y(y) {}
 };
 
+int g_alloc_blocks = 0;
+
+// Stateless, counts the blocks in use
+template <class T> struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator() = default;
+
+  template <class U> CountingAllocator(const CountingAllocator<U> &) {}
+
+  T *allocate(std::size_t n) {
+    ++g_alloc_blocks;
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *ptr, std::size_t n) {
+    --g_alloc_blocks;
+    std::allocator<T>{}.deallocate(ptr, n);
+  }
+};
+
 TEST_CASE("shared cons_des") {
   my_shared_ptr<int> x(new int(12));
   REQUIRE(x.get());
@@ -60,8 +81,8 @@ TEST_CASE("shared constructor") {
 
     {
       my_shared_ptr<int> x(ptr, [&ptr_addr](int *ptr) {
-        delete ptr;
         ptr_addr = ptr;
+        delete ptr;
       });
       REQUIRE(x.get() == ptr);
       REQUIRE(x.use_count() == 1);
@@ -827,3 +848,19 @@ TEST_CASE("weak basics make_shared") {
     REQUIRE(s2.use_count() == 0);
   }
 }
+
+TEST_CASE("shared allocate_my_shared") {
+  auto s = allocate_my_shared<Child>(CountingAllocator<Child>{}, 4, 8);
+  REQUIRE(s->x == 4);
+  REQUIRE(s->y == 8);
+  REQUIRE(s.use_count() == 1);
+  REQUIRE(g_alloc_blocks == 1);
+
+  // Freed once the last weak_ptr is gone
+  my_weak_ptr<Child> w(s);
+  s.reset();
+  REQUIRE(w.expired());
+  REQUIRE(g_alloc_blocks == 1);
+  w.reset();
+  REQUIRE(g_alloc_blocks == 0);
+}
@@ -0,0 +1,151 @@
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "my_shared_ptr.hh"
+#include "my_weak_ptr.hh"
+
+namespace {
+
+// Monotonic arena: memory is only given back all at once, with reset()
+class Arena {
+public:
+  explicit Arena(std::size_t size)
+      : _buf(new char[size]), _size(size), _used(0), _live(0) {}
+
+  void *allocate(std::size_t size, std::size_t align) {
+    std::size_t start = (_used + align - 1) / align * align;
+    if (start + size > _size)
+      throw std::bad_alloc{};
+
+    _used = start + size;
+    ++_live;
+    return _buf.get() + start;
+  }
+
+  void deallocate() { --_live; }
+
+  void reset() {
+    REQUIRE(_live == 0);
+    _used = 0;
+  }
+
+  bool owns(const void *ptr) const {
+    auto p = static_cast<const char *>(ptr);
+    return p >= _buf.get() && p < _buf.get() + _size;
+  }
+
+  std::size_t used() const { return _used; }
+  std::size_t live() const { return _live; }
+
+private:
+  std::unique_ptr<char[]> _buf;
+  std::size_t _size;
+  std::size_t _used;
+  std::size_t _live;
+};
+
+// Stateful allocator, refers to an arena
+template <class T> struct ArenaAllocator {
+  using value_type = T;
+
+  Arena *arena;
+
+  explicit ArenaAllocator(Arena *arena) : arena(arena) {}
+
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U> &a) : arena(a.arena) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *, std::size_t) { arena->deallocate(); }
+
+  template <class U> bool operator==(const ArenaAllocator<U> &a) const {
+    return arena == a.arena;
+  }
+
+  template <class U> bool operator!=(const ArenaAllocator<U> &a) const {
+    return arena != a.arena;
+  }
+};
+
+struct Node {
+  std::string name;
+  my_shared_ptr<Node> next;
+
+  Node(std::string name, my_shared_ptr<Node> next)
+      : name(std::move(name)), next(std::move(next)) {}
+};
+
+} // namespace
+
+TEST_CASE("allocate_my_shared arena") {
+  Arena arena(64 * 1024);
+  ArenaAllocator<Node> alloc(&arena);
+
+  for (std::size_t round = 0; round < 3; ++round) {
+    my_shared_ptr<Node> head;
+    for (int i = 0; i < 100; ++i)
+      head = allocate_my_shared<Node>(alloc, std::to_string(i), head);
+
+    REQUIRE(arena.live() == 100);
+    REQUIRE(arena.owns(head.get()));
+    REQUIRE(head->name == "99");
+    REQUIRE(head->next->name == "98");
+
+    // A weak_ptr keeps the block, not the object
+    my_weak_ptr<Node> weak(head->next);
+    head.reset();
+    REQUIRE(weak.expired());
+    REQUIRE(arena.live() == 1);
+    weak.reset();
+    REQUIRE(arena.live() == 0);
+
+    // Everything released in one shot
+    std::size_t used = arena.used();
+    REQUIRE(used > 0);
+    arena.reset();
+  }
+
+  // Out of arena memory
+  Arena small(16);
+  REQUIRE_THROWS_AS(
+      allocate_my_shared<Node>(ArenaAllocator<Node>(&small), "x", nullptr),
+      std::bad_alloc);
+  REQUIRE(small.live() == 0);
+}
+
+TEST_CASE("my_shared_ptr deleter, block in arena") {
+  Arena arena(1024);
+  ArenaAllocator<int> alloc(&arena);
+
+  int deleted = 0;
+  auto deleter = [&deleted](int *ptr) {
+    ++deleted;
+    delete ptr;
+  };
+
+  {
+    my_shared_ptr<int> x(new int(3), deleter, alloc);
+    REQUIRE(arena.live() == 1);
+    REQUIRE(*x == 3);
+
+    my_weak_ptr<int> weak(x);
+    x.reset();
+    REQUIRE(deleted == 1);
+    REQUIRE(arena.live() == 1);
+  }
+  REQUIRE(arena.live() == 0);
+
+  // The pointer is deleted if the block can't be allocated
+  Arena small(8);
+  REQUIRE_THROWS_AS(
+      my_shared_ptr<int>(new int(4), deleter, ArenaAllocator<int>(&small)),
+      std::bad_alloc);
+  REQUIRE(deleted == 2);
+}
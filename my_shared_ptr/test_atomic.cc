@@ -0,0 +1,135 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../utils/xorshift.hh"
+#include "my_atomic_shared_ptr.hh"
+
+namespace {
+
+constexpr std::size_t NB_THREADS = 8;
+constexpr std::size_t NB_ITERS = 100000;
+
+struct Obj {
+  static std::atomic<std::size_t> created;
+  static std::atomic<std::size_t> deleted;
+
+  std::size_t id;
+  std::size_t check;
+
+  Obj(std::size_t id) : id(id), check(~id) { ++created; }
+
+  ~Obj() {
+    check = 0;
+    ++deleted;
+  }
+};
+
+std::atomic<std::size_t> Obj::created{};
+std::atomic<std::size_t> Obj::deleted{};
+
+// Fair locks hand the lock over to preempted waiters, keep it short
+template <class Lock> constexpr std::size_t nb_iters = NB_ITERS / 10;
+template <> constexpr std::size_t nb_iters<LockFree> = NB_ITERS;
+
+template <class Lock> my_atomic_shared_ptr<Obj, Lock> *g_ptr;
+std::atomic<bool> g_ready;
+
+template <class Lock> void runner(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  Xorshift rng(tid + 1);
+  auto &ptr = *g_ptr<Lock>;
+
+  for (std::size_t i = 0; i < nb_iters<Lock>; ++i) {
+    auto val = ptr.load();
+    REQUIRE(val);
+    REQUIRE(val->check == ~val->id);
+
+    if (rng.next(16) == 0) {
+      auto old = ptr.exchange(make_my_shared<Obj>(tid * NB_ITERS + i));
+      REQUIRE(old->check == ~old->id);
+    } else if (rng.next(4) == 0) {
+      auto desired = make_my_shared<Obj>(tid * NB_ITERS + i);
+      while (!ptr.compare_exchange(val, desired))
+        REQUIRE(val->check == ~val->id);
+    }
+  }
+}
+
+} // namespace
+
+#define LOCK_POLICIES                                                          \
+  LockFree, Spinlock, TtasLock, TicketLock, McsLock, std::mutex
+
+TEMPLATE_TEST_CASE("atomic load / compare_exchange / exchange", "",
+                   LOCK_POLICIES) {
+  my_atomic_shared_ptr<int, TestType> ptr;
+  REQUIRE(!ptr);
+  REQUIRE(!ptr.load());
+
+  auto x = make_my_shared<int>(12);
+  my_shared_ptr<int> exp;
+  REQUIRE(ptr.compare_exchange(exp, x));
+  REQUIRE(ptr);
+  REQUIRE(x.use_count() == 2);
+
+  auto y = make_my_shared<int>(15);
+  REQUIRE(!ptr.compare_exchange(exp, y));
+  REQUIRE(exp == x);
+  REQUIRE(x.use_count() == 3);
+
+  {
+    auto val = ptr.load();
+    REQUIRE(val == x);
+    REQUIRE(*val == 12);
+    REQUIRE(x.use_count() == 4);
+  }
+
+  REQUIRE(ptr.compare_exchange(exp, y));
+  REQUIRE(ptr.load() == y);
+  REQUIRE(y.use_count() == 2);
+  exp.reset();
+  REQUIRE(x.use_count() == 1);
+
+  auto old = ptr.exchange(x);
+  REQUIRE(old == y);
+  REQUIRE(y.use_count() == 2);
+  REQUIRE(x.use_count() == 2);
+
+  old = ptr.exchange(nullptr);
+  REQUIRE(old == x);
+  REQUIRE(!ptr);
+  REQUIRE(y.use_count() == 1);
+  REQUIRE(x.use_count() == 2);
+}
+
+TEMPLATE_TEST_CASE("atomic multi load / compare_exchange / exchange", "",
+                   LOCK_POLICIES) {
+  Obj::created = 0;
+  Obj::deleted = 0;
+  g_ptr<TestType> =
+      new my_atomic_shared_ptr<Obj, TestType>(make_my_shared<Obj>(0));
+
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < NB_THREADS; ++i)
+    ths.emplace_back(runner<TestType>, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+#ifdef MY_SHARED_PTR_BIASED
+  // The first value, released by a worker, waits for this thread to merge it
+  BiasedOwner::drain_current();
+#endif
+
+  REQUIRE(Obj::deleted + 1 == Obj::created);
+  delete g_ptr<TestType>;
+  REQUIRE(Obj::deleted == Obj::created);
+}
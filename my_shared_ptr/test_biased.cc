@@ -0,0 +1,112 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "my_shared_ptr.hh"
+#include "my_weak_ptr.hh"
+
+// References released by another thread than the one that created the object
+// In biased mode: the owner thread merges them, or the releasing thread once
+// the owner exited
+
+namespace {
+
+constexpr std::size_t NB_OBJS = 10000;
+
+struct Obj {
+  static std::atomic<std::size_t> deleted;
+
+  ~Obj() { ++deleted; }
+};
+
+std::atomic<std::size_t> Obj::deleted{};
+
+} // namespace
+
+TEST_CASE("biased released by another thread, owner alive") {
+  Obj::deleted = 0;
+
+  auto obj = make_my_shared<Obj>();
+  auto copy = obj;
+  std::thread th([copy = std::move(copy)]() mutable { copy.reset(); });
+  th.join();
+
+  REQUIRE(Obj::deleted == 0);
+  REQUIRE(obj.use_count() == 1);
+  obj.reset();
+  REQUIRE(Obj::deleted == 1);
+}
+
+TEST_CASE("biased released by another thread, owner exited") {
+  Obj::deleted = 0;
+
+  std::vector<my_shared_ptr<Obj>> objs;
+  std::thread th([&objs] {
+    for (std::size_t i = 0; i < NB_OBJS; ++i) {
+      auto obj = make_my_shared<Obj>();
+      objs.push_back(obj);
+    }
+  });
+  th.join();
+
+  REQUIRE(Obj::deleted == 0);
+  for (auto &obj : objs)
+    REQUIRE(obj.use_count() == 1);
+
+  objs.clear();
+  REQUIRE(Obj::deleted == NB_OBJS);
+}
+
+TEST_CASE("biased weak lock from another thread") {
+  Obj::deleted = 0;
+
+  auto obj = make_my_shared<Obj>();
+  my_weak_ptr<Obj> weak(obj);
+
+  std::thread th([&weak] {
+    auto locked = weak.lock();
+    REQUIRE(locked);
+  });
+  th.join();
+
+  obj.reset();
+  REQUIRE(Obj::deleted == 1);
+  REQUIRE(!weak.lock());
+}
+
+TEST_CASE("biased producer / consumer") {
+  Obj::deleted = 0;
+
+  std::atomic<my_shared_ptr<Obj> *> slot{nullptr};
+  std::atomic<bool> done{false};
+
+  // The producer keeps running: queued objects are merged on its decrements
+  std::thread producer([&] {
+    for (std::size_t i = 0; i < NB_OBJS; ++i) {
+      auto obj = new my_shared_ptr<Obj>(make_my_shared<Obj>());
+      auto keep = *obj;
+      while (slot.load())
+        std::this_thread::yield();
+      slot = obj;
+    }
+
+    while (!done)
+      std::this_thread::yield();
+  });
+
+  std::thread consumer([&] {
+    for (std::size_t i = 0; i < NB_OBJS; ++i) {
+      my_shared_ptr<Obj> *obj;
+      while (!(obj = slot.exchange(nullptr)))
+        std::this_thread::yield();
+      delete obj;
+    }
+    done = true;
+  });
+
+  producer.join();
+  consumer.join();
+  REQUIRE(Obj::deleted == NB_OBJS);
+}
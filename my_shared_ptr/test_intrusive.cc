@@ -0,0 +1,217 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "../utils/xorshift.hh"
+#include "my_atomic_intrusive_ptr.hh"
+#include "my_intrusive_ptr.hh"
+
+namespace {
+
+constexpr std::size_t NB_THREADS = 8;
+constexpr std::size_t NB_ITERS = 100000;
+
+struct Obj : my_intrusive_base<Obj> {
+  static std::atomic<std::size_t> created;
+  static std::atomic<std::size_t> deleted;
+
+  std::size_t id;
+  std::size_t check;
+
+  Obj(std::size_t id) : id(id), check(~id) { ++created; }
+
+  virtual ~Obj() {
+    check = 0;
+    ++deleted;
+  }
+};
+
+std::atomic<std::size_t> Obj::created{};
+std::atomic<std::size_t> Obj::deleted{};
+
+struct Child : Obj {
+  Child(std::size_t id) : Obj(id) {}
+};
+
+// Not deleted, counted and destroyed in place
+struct Local : my_intrusive_base<Local, RefCounter> {
+  static std::size_t destroyed;
+
+  static void intrusive_destroy(Local *ptr) {
+    ptr->~Local();
+    ++destroyed;
+  }
+};
+
+std::size_t Local::destroyed = 0;
+
+my_atomic_intrusive_ptr<Obj> *g_ptr;
+std::atomic<bool> g_ready;
+
+void runner(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  Xorshift rng(tid + 1);
+  auto &ptr = *g_ptr;
+
+  for (std::size_t i = 0; i < NB_ITERS; ++i) {
+    auto val = ptr.load();
+    REQUIRE(val);
+    REQUIRE(val->check == ~val->id);
+
+    if (rng.next(16) == 0) {
+      auto old = ptr.exchange(make_my_intrusive<Obj>(tid * NB_ITERS + i));
+      REQUIRE(old->check == ~old->id);
+    } else if (rng.next(4) == 0) {
+      auto desired = make_my_intrusive<Obj>(tid * NB_ITERS + i);
+      while (!ptr.compare_exchange(val, desired))
+        REQUIRE(val->check == ~val->id);
+    }
+  }
+}
+
+} // namespace
+
+TEST_CASE("intrusive single word") {
+  static_assert(sizeof(my_intrusive_ptr<Obj>) == sizeof(void *), "");
+}
+
+TEST_CASE("intrusive copy / move / reset") {
+  Obj::created = 0;
+  Obj::deleted = 0;
+
+  auto r1 = make_my_intrusive<Obj>(12);
+  REQUIRE(r1.use_count() == 1);
+  REQUIRE(r1->id == 12);
+
+  {
+    auto r2 = r1;
+    REQUIRE(r1.use_count() == 2);
+    REQUIRE(r2 == r1);
+
+    // The count is in the object, a raw pointer can be shared again
+    my_intrusive_ptr<Obj> r3(r1.get());
+    REQUIRE(r1.use_count() == 3);
+  }
+  REQUIRE(r1.use_count() == 1);
+
+  auto r4 = std::move(r1);
+  REQUIRE(!r1);
+  REQUIRE(r1 == nullptr);
+  REQUIRE(r4.use_count() == 1);
+
+  r4.reset(new Obj(15));
+  REQUIRE(Obj::deleted == 1);
+  REQUIRE(r4->id == 15);
+
+  r4.reset();
+  REQUIRE(Obj::deleted == Obj::created);
+}
+
+TEST_CASE("intrusive conversions") {
+  Obj::created = 0;
+  Obj::deleted = 0;
+
+  my_intrusive_ptr<Child> c = make_my_intrusive<Child>(3);
+  my_intrusive_ptr<Obj> o = c;
+  REQUIRE(c.use_count() == 2);
+  REQUIRE(o == c);
+
+  o = std::move(c);
+  REQUIRE(!c);
+  REQUIRE(o.use_count() == 1);
+
+  o.reset();
+  REQUIRE(Obj::deleted == 1);
+}
+
+TEST_CASE("intrusive custom destroy") {
+  alignas(Local) unsigned char buf[sizeof(Local)];
+  {
+    my_intrusive_ptr<Local> r(new (buf) Local);
+    auto r2 = r;
+    REQUIRE(r.use_count() == 2);
+  }
+  REQUIRE(Local::destroyed == 1);
+}
+
+TEST_CASE("intrusive lock") {
+  alignas(Local) unsigned char buf[sizeof(Local)];
+  Local *ptr = new (buf) Local;
+  std::size_t destroyed = Local::destroyed;
+  {
+    my_intrusive_ptr<Local> r(ptr);
+    auto r2 = my_intrusive_ptr<Local>::lock(ptr);
+    REQUIRE(r2 == r);
+    REQUIRE(r.use_count() == 2);
+  }
+  REQUIRE(Local::destroyed == destroyed + 1);
+
+  // Count dropped to 0, even if the memory is still there
+  REQUIRE(!my_intrusive_ptr<Local>::lock(ptr));
+  REQUIRE(!my_intrusive_ptr<Local>::lock(nullptr));
+}
+
+TEST_CASE("atomic intrusive load / compare_exchange / exchange") {
+  my_atomic_intrusive_ptr<Obj> ptr;
+  REQUIRE(!ptr);
+  REQUIRE(!ptr.load());
+
+  auto x = make_my_intrusive<Obj>(12);
+  my_intrusive_ptr<Obj> exp;
+  REQUIRE(ptr.compare_exchange(exp, x));
+  REQUIRE(ptr);
+  REQUIRE(x.use_count() == 2);
+
+  auto y = make_my_intrusive<Obj>(15);
+  REQUIRE(!ptr.compare_exchange(exp, y));
+  REQUIRE(exp == x);
+  REQUIRE(x.use_count() == 3);
+
+  {
+    auto val = ptr.load();
+    REQUIRE(val == x);
+    REQUIRE(val->id == 12);
+    REQUIRE(x.use_count() == 4);
+  }
+
+  REQUIRE(ptr.compare_exchange(exp, y));
+  REQUIRE(ptr.load() == y);
+  REQUIRE(y.use_count() == 2);
+  exp.reset();
+  REQUIRE(x.use_count() == 1);
+
+  auto old = ptr.exchange(x);
+  REQUIRE(old == y);
+  REQUIRE(y.use_count() == 2);
+  REQUIRE(x.use_count() == 2);
+
+  old = ptr.exchange(nullptr);
+  REQUIRE(old == x);
+  REQUIRE(!ptr);
+  REQUIRE(y.use_count() == 1);
+  REQUIRE(x.use_count() == 2);
+}
+
+TEST_CASE("atomic intrusive multi load / compare_exchange / exchange") {
+  Obj::created = 0;
+  Obj::deleted = 0;
+  g_ptr = new my_atomic_intrusive_ptr<Obj>(make_my_intrusive<Obj>(0));
+
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < NB_THREADS; ++i)
+    ths.emplace_back(runner, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(Obj::deleted + 1 == Obj::created);
+  delete g_ptr;
+  REQUIRE(Obj::deleted == Obj::created);
+}
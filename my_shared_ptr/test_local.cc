@@ -0,0 +1,99 @@
+#include <catch2/catch.hpp>
+
+#include <type_traits>
+#include <vector>
+
+#include "my_shared_from_this.hh"
+#include "my_shared_ptr.hh"
+#include "my_weak_ptr.hh"
+
+namespace {
+
+struct Obj {
+  static std::size_t deleted;
+
+  int x;
+
+  Obj(int x) : x(x) {}
+  ~Obj() { ++deleted; }
+};
+
+std::size_t Obj::deleted = 0;
+
+struct Base {
+  virtual ~Base() = default;
+};
+
+struct Child : Base {};
+
+class Foo : public enable_my_shared_from_this<Foo, RefCounter> {};
+
+} // namespace
+
+TEST_CASE("local counter policy") {
+  static_assert(std::is_same<my_local_shared_ptr<int>,
+                             my_shared_ptr<int, RefCounter>>::value,
+                "");
+  static_assert(!std::is_convertible<my_local_shared_ptr<int>,
+                                     my_shared_ptr<int>>::value,
+                "counters can't be mixed");
+  static_assert(sizeof(ControlBlock<RefCounter>) <= sizeof(ControlBlock<>),
+                "");
+}
+
+TEST_CASE("local copy / destroy") {
+  Obj::deleted = 0;
+
+  auto r1 = make_my_local_shared<Obj>(12);
+  REQUIRE(r1.use_count() == 1);
+  REQUIRE(r1->x == 12);
+
+  {
+    std::vector<my_local_shared_ptr<Obj>> copies(16, r1);
+    REQUIRE(r1.use_count() == 17);
+  }
+  REQUIRE(r1.use_count() == 1);
+
+  auto r2 = std::move(r1);
+  REQUIRE(!r1);
+  REQUIRE(r2.use_count() == 1);
+
+  r2.reset();
+  REQUIRE(Obj::deleted == 1);
+
+  my_local_shared_ptr<Obj> r3(new Obj(15));
+  REQUIRE(r3.use_count() == 1);
+  r3.reset();
+  REQUIRE(Obj::deleted == 2);
+}
+
+TEST_CASE("local weak") {
+  auto r = make_my_local_shared<Obj>(8);
+  my_local_weak_ptr<Obj> w(r);
+  REQUIRE(r.get_raw_weak_count() == 2);
+  REQUIRE(w.lock() == r);
+
+  r.reset();
+  REQUIRE(w.expired());
+  REQUIRE(!w.lock());
+  REQUIRE_THROWS(my_local_shared_ptr<Obj>(w));
+}
+
+TEST_CASE("local conversions") {
+  my_local_shared_ptr<Child> c(new Child);
+  my_local_shared_ptr<Base> b = c;
+  REQUIRE(c.use_count() == 2);
+
+  my_local_weak_ptr<Base> w(c);
+  REQUIRE(w.lock() == b);
+}
+
+TEST_CASE("local shared_from_this") {
+  auto r1 = make_my_local_shared<Foo>();
+  {
+    my_local_shared_ptr<Foo> r2 = r1->shared_from_this();
+    REQUIRE(r2 == r1);
+    REQUIRE(r1.use_count() == 2);
+  }
+  REQUIRE(r1.use_count() == 1);
+}
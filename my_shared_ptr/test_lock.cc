@@ -0,0 +1,63 @@
+#include <catch2/catch.hpp>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "spinlock.hh"
+
+namespace {
+
+constexpr std::size_t NB_THREADS = 8;
+// Fair locks hand the lock over to preempted waiters, keep it short
+constexpr std::size_t NB_ITERS = 20000;
+
+} // namespace
+
+TEMPLATE_TEST_CASE("lock mutual exclusion", "", Spinlock, TtasLock,
+                   TicketLock, McsLock) {
+  TestType lock;
+  std::size_t counter = 0;
+  std::atomic<bool> ready{false};
+
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < NB_THREADS; ++i)
+    ths.emplace_back([&] {
+      while (!ready)
+        continue;
+
+      for (std::size_t j = 0; j < NB_ITERS; ++j) {
+        std::lock_guard<TestType> guard(lock);
+        ++counter;
+      }
+    });
+
+  ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(counter == NB_THREADS * NB_ITERS);
+}
+
+TEST_CASE("mcs lock hold several, unlock out of order") {
+  McsLock a;
+  McsLock b;
+  std::size_t counter = 0;
+
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < NB_THREADS; ++i)
+    ths.emplace_back([&] {
+      for (std::size_t j = 0; j < NB_ITERS; ++j) {
+        a.lock();
+        b.lock();
+        ++counter;
+        a.unlock();
+        b.unlock();
+      }
+    });
+
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(counter == NB_THREADS * NB_ITERS);
+}
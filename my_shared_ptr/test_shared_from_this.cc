@@ -50,3 +50,21 @@ TEST_CASE("shared_from_this local") {
   Foo r1(23);
   REQUIRE_THROWS(r1.shared_from_this());
 }
+
+TEST_CASE("weak_from_this deferred deleter") {
+  Foo *retired = nullptr;
+  auto r1 = my_shared_ptr<Foo>(new Foo(23), [&retired](Foo *ptr) {
+    retired = ptr;
+  });
+
+  auto weak = r1->weak_from_this();
+  REQUIRE(weak.lock() == r1);
+  REQUIRE(r1.use_count() == 1);
+
+  // Still alive, but no more owner
+  Foo *ptr = r1.get();
+  r1.reset();
+  REQUIRE(retired == ptr);
+  REQUIRE(!ptr->weak_from_this().lock());
+  delete ptr;
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Pool of fixed size blocks, with thread-local free lists
+//
+// Each thread owns a cache, blocks are carved from chunks allocated by a cache
+// and belong to it (the owner is stored in a header before the block).
+// - allocate: local free list, then blocks given back by other threads, then a
+//   new chunk
+// - free by the owner: local free list, no synchronization
+// - free by another thread: kept aside per owner, and handed back with a
+//   single CAS once BATCH_SIZE of them are pending, or when the thread exits
+// The cache of an exited thread is adopted by the next new thread: chunks are
+// never given back to the system.
+// After its cache is released (thread exit), a thread still works, with plain
+// operator new / delete blocks.
+template <std::size_t Size> class NodePool {
+
+  struct Cache;
+
+  struct Block {
+    // nullptr if not from a chunk
+    Cache *owner;
+    Block *next;
+  };
+
+  static_assert(Size % alignof(std::max_align_t) == 0,
+                "Size must keep blocks aligned");
+  static_assert(sizeof(Block) % alignof(std::max_align_t) == 0,
+                "The header must keep blocks aligned");
+
+  static constexpr std::size_t STRIDE = sizeof(Block) + Size;
+  static constexpr std::size_t CHUNK_BLOCKS = 256;
+  static constexpr std::size_t BATCH_SIZE = 64;
+  static constexpr std::size_t PENDING_SLOTS = 8;
+
+  // Blocks freed for another owner, not handed back yet
+  struct Pending {
+    Cache *owner = nullptr;
+    Block *first = nullptr;
+    Block *last = nullptr;
+    std::size_t count = 0;
+  };
+
+  struct alignas(64) Cache {
+    Block *local = nullptr;
+    Pending pending[PENDING_SLOTS];
+    std::vector<std::unique_ptr<char[]>> chunks;
+
+    // Freed by other threads, linked with next
+    alignas(64) std::atomic<Block *> remote{nullptr};
+  };
+
+public:
+  // Never destroyed: blocks can be freed by static or thread_local destructors
+  static NodePool &instance() {
+    static NodePool *res = new NodePool;
+    return *res;
+  }
+
+  NodePool(const NodePool &) = delete;
+  NodePool &operator=(const NodePool &) = delete;
+
+  void *allocate() {
+    Cache *cache = _local_cache();
+    if (!cache)
+      return _to_ptr(_unpooled_block());
+
+    Block *block = cache->local;
+    if (!block)
+      block = cache->remote.exchange(nullptr, std::memory_order_acquire);
+    if (!block) {
+      _add_chunk(*cache, CHUNK_BLOCKS);
+      block = cache->local;
+    }
+
+    cache->local = block->next;
+    return _to_ptr(block);
+  }
+
+  void deallocate(void *ptr) {
+    Block *block = _to_block(ptr);
+    Cache *owner = block->owner;
+    if (!owner) {
+      ::operator delete(block);
+      return;
+    }
+
+    Cache *cache = _local_cache();
+    if (cache == owner) {
+      block->next = cache->local;
+      cache->local = block;
+    } else if (!cache)
+      _give_back(owner, block, block);
+    else
+      _defer_give_back(*cache, owner, block);
+  }
+
+  // Adds n free blocks to the cache of the calling thread
+  void reserve(std::size_t n) {
+    Cache *cache = _local_cache();
+    if (cache && n)
+      _add_chunk(*cache, n);
+  }
+
+  // Here for debug / test: number of blocks carved from chunks
+  std::size_t capacity() const { return _capacity.load(); }
+
+private:
+  std::mutex _mut;
+  std::vector<std::unique_ptr<Cache>> _caches;
+  std::vector<Cache *> _orphans;
+  std::atomic<std::size_t> _capacity;
+
+  NodePool() : _capacity(0) {}
+
+  // Trivial thread_locals, still valid while other thread_locals are destroyed
+  static Cache *&_tl_cache() {
+    thread_local Cache *res = nullptr;
+    return res;
+  }
+
+  static bool &_tl_exited() {
+    thread_local bool res = false;
+    return res;
+  }
+
+  struct ExitGuard {
+    ~ExitGuard() {
+      instance()._release_cache(_tl_cache());
+      _tl_cache() = nullptr;
+      _tl_exited() = true;
+    }
+  };
+
+  Cache *_local_cache() {
+    Cache *&cache = _tl_cache();
+    if (!cache && !_tl_exited()) {
+      cache = _acquire_cache();
+      thread_local ExitGuard guard;
+      (void)guard;
+    }
+    return cache;
+  }
+
+  Cache *_acquire_cache() {
+    std::lock_guard<std::mutex> lock(_mut);
+    if (!_orphans.empty()) {
+      Cache *res = _orphans.back();
+      _orphans.pop_back();
+      return res;
+    }
+
+    _caches.push_back(std::make_unique<Cache>());
+    return _caches.back().get();
+  }
+
+  void _release_cache(Cache *cache) {
+    for (Pending &slot : cache->pending)
+      _flush(slot);
+
+    std::lock_guard<std::mutex> lock(_mut);
+    _orphans.push_back(cache);
+  }
+
+  void _add_chunk(Cache &cache, std::size_t n) {
+    cache.chunks.push_back(std::make_unique<char[]>(n * STRIDE));
+    char *mem = cache.chunks.back().get();
+
+    for (std::size_t i = n; i-- > 0;) {
+      Block *block = reinterpret_cast<Block *>(mem + i * STRIDE);
+      block->owner = &cache;
+      block->next = cache.local;
+      cache.local = block;
+    }
+    _capacity.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void _defer_give_back(Cache &cache, Cache *owner, Block *block) {
+    auto hash = reinterpret_cast<std::uintptr_t>(owner) / alignof(Cache);
+    Pending &slot = cache.pending[hash % PENDING_SLOTS];
+    if (slot.owner != owner) {
+      _flush(slot);
+      slot.owner = owner;
+    }
+
+    block->next = slot.first;
+    if (!slot.first)
+      slot.last = block;
+    slot.first = block;
+
+    if (++slot.count >= BATCH_SIZE)
+      _flush(slot);
+  }
+
+  static void _flush(Pending &slot) {
+    if (!slot.count)
+      return;
+
+    _give_back(slot.owner, slot.first, slot.last);
+    slot.first = nullptr;
+    slot.last = nullptr;
+    slot.count = 0;
+  }
+
+  static void _give_back(Cache *owner, Block *first, Block *last) {
+    last->next = owner->remote.load(std::memory_order_relaxed);
+    while (!owner->remote.compare_exchange_weak(last->next, first,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed))
+      continue;
+  }
+
+  static Block *_unpooled_block() {
+    Block *block = static_cast<Block *>(::operator new(STRIDE));
+    block->owner = nullptr;
+    return block;
+  }
+
+  static void *_to_ptr(Block *block) { return block + 1; }
+
+  static Block *_to_block(void *ptr) { return static_cast<Block *>(ptr) - 1; }
+};
+
+// Stateless allocator on top of NodePool, with one pool per block size
+// Only single objects come from the pools, arrays use operator new
+template <class T> class PoolAllocator {
+public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+
+  template <class U> PoolAllocator(const PoolAllocator<U> &) {}
+
+  T *allocate(std::size_t n) {
+    if (n != 1)
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    return static_cast<T *>(_pool().allocate());
+  }
+
+  void deallocate(T *ptr, std::size_t n) {
+    if (n != 1)
+      ::operator delete(ptr);
+    else
+      _pool().deallocate(ptr);
+  }
+
+  // Adds n free blocks of sizeof(T) to the calling thread
+  static void reserve(std::size_t n) { _pool().reserve(n); }
+
+  template <class U> bool operator==(const PoolAllocator<U> &) const {
+    return true;
+  }
+
+  template <class U> bool operator!=(const PoolAllocator<U> &) const {
+    return false;
+  }
+
+private:
+  static constexpr std::size_t _block_size() {
+    constexpr std::size_t align = alignof(std::max_align_t);
+    static_assert(alignof(T) <= align, "Over-aligned types not supported");
+    return (sizeof(T) + align - 1) / align * align;
+  }
+
+  // Deduced: T can still be incomplete when the allocator type is used
+  static auto &_pool() {
+    return NodePool<_block_size()>::instance();
+  }
+};
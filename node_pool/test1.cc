@@ -0,0 +1,137 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../utils/xorshift.hh"
+#include "node_pool.hh"
+
+namespace {
+
+constexpr std::size_t NB_THREADS = 8;
+constexpr std::size_t NB_ITERS = 100000;
+
+struct Obj {
+  std::size_t id;
+  std::size_t check;
+  char pad[48];
+
+  Obj(std::size_t id) : id(id), check(~id) {}
+};
+
+std::mutex g_mut;
+std::vector<Obj *> g_objs;
+std::atomic<bool> g_ready;
+
+// Allocates, or frees an object allocated by any thread
+void runner(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  PoolAllocator<Obj> alloc;
+  Xorshift rng(tid + 1);
+
+  for (std::size_t i = 0; i < NB_ITERS; ++i) {
+    if (rng.next(2) == 0) {
+      Obj *obj = alloc.allocate(1);
+      new (obj) Obj(tid * NB_ITERS + i);
+      std::lock_guard<std::mutex> lock(g_mut);
+      g_objs.push_back(obj);
+      continue;
+    }
+
+    Obj *obj = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(g_mut);
+      if (g_objs.empty())
+        continue;
+      obj = g_objs.back();
+      g_objs.pop_back();
+    }
+
+    REQUIRE(obj->check == ~obj->id);
+    obj->check = 0;
+    alloc.deallocate(obj, 1);
+  }
+}
+
+} // namespace
+
+TEST_CASE("pool reuse") {
+  PoolAllocator<std::uint64_t> alloc;
+
+  std::uint64_t *x = alloc.allocate(1);
+  alloc.deallocate(x, 1);
+  REQUIRE(alloc.allocate(1) == x);
+  alloc.deallocate(x, 1);
+
+  auto &pool = NodePool<16>::instance();
+  std::size_t capacity = pool.capacity();
+  for (std::size_t i = 0; i < NB_ITERS; ++i)
+    alloc.deallocate(alloc.allocate(1), 1);
+  REQUIRE(pool.capacity() == capacity);
+
+  // Arrays don't come from the pool
+  std::vector<std::uint64_t, PoolAllocator<std::uint64_t>> vec(1000, 3);
+  REQUIRE(vec[999] == 3);
+}
+
+TEST_CASE("pool reserve") {
+  auto &pool = NodePool<32>::instance();
+  std::size_t capacity = pool.capacity();
+
+  pool.reserve(1000);
+  REQUIRE(pool.capacity() == capacity + 1000);
+
+  std::vector<void *> blocks;
+  for (std::size_t i = 0; i < 1000; ++i)
+    blocks.push_back(pool.allocate());
+  REQUIRE(pool.capacity() == capacity + 1000);
+
+  for (void *block : blocks)
+    pool.deallocate(block);
+}
+
+TEST_CASE("pool free by other thread") {
+  auto &pool = NodePool<48>::instance();
+
+  std::vector<void *> blocks;
+  for (std::size_t i = 0; i < 10000; ++i)
+    blocks.push_back(pool.allocate());
+  std::size_t capacity = pool.capacity();
+
+  // Handed back to this thread, in batches and when the thread exits
+  std::thread other([&blocks, &pool] {
+    for (void *block : blocks)
+      pool.deallocate(block);
+  });
+  other.join();
+
+  for (std::size_t i = 0; i < blocks.size(); ++i)
+    blocks[i] = pool.allocate();
+  REQUIRE(pool.capacity() == capacity);
+
+  for (void *block : blocks)
+    pool.deallocate(block);
+}
+
+TEST_CASE("pool multi allocate / free") {
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < NB_THREADS; ++i)
+    ths.emplace_back(runner, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  PoolAllocator<Obj> alloc;
+  for (Obj *obj : g_objs) {
+    REQUIRE(obj->check == ~obj->id);
+    alloc.deallocate(obj, 1);
+  }
+  g_objs.clear();
+}
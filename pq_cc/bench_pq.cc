@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "locked_heap_pq.hh"
+#include "skiplist_pq.hh"
+#include "xorshift.hh"
+
+// Each thread pushes a random key then pops the smallest one, on a queue
+// prefilled with random keys, through the skiplist and the heap under a mutex
+// Output: CSV, one line per structure and number of threads
+
+namespace {
+
+constexpr std::size_t PREFILL = 64 * 1024;
+constexpr std::uint64_t MAX_KEY = 1 << 30;
+
+std::atomic<bool> g_ready;
+
+template <class F> double timed_run(std::size_t nb_threads, F fun) {
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < nb_threads; ++i)
+    ths.emplace_back([&fun, i] {
+      while (!g_ready)
+        continue;
+      fun(i);
+    });
+
+  auto start = std::chrono::steady_clock::now();
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  std::chrono::duration<double> dur = std::chrono::steady_clock::now() - start;
+  return dur.count();
+}
+
+template <class Pq>
+double bench_pq(std::size_t nb_threads, std::size_t items_per_thread) {
+  Pq pq;
+  Xorshift xs(172847);
+  for (std::size_t i = 0; i < PREFILL; ++i)
+    pq.push(xs.next(MAX_KEY), i);
+
+  return timed_run(nb_threads, [&](std::size_t tid) {
+    Xorshift rng(tid + 1);
+    std::uint64_t key;
+    std::uint64_t val;
+    for (std::uint64_t i = 0; i < items_per_thread; ++i) {
+      pq.push(rng.next(MAX_KEY), i);
+      pq.try_pop(key, val);
+    }
+  });
+}
+
+void report(const char *structure, std::size_t nb_threads, std::size_t items,
+            double dur) {
+  // push + pop for each item
+  std::cout << structure << "," << nb_threads << ","
+            << static_cast<std::uint64_t>(2 * items / dur) << std::endl;
+}
+
+} // namespace
+
+// Usage: bench_pq.bin [max_threads] [items]
+int main(int argc, char **argv) {
+  std::size_t max_threads =
+      argc > 1 ? std::stoul(argv[1])
+               : std::max(1u, std::thread::hardware_concurrency());
+  std::size_t items = argc > 2 ? std::stoul(argv[2]) : 1024 * 1024;
+
+  std::cout << "structure,threads,ops_per_sec" << std::endl;
+  for (std::size_t nb_threads = 1; nb_threads <= max_threads;
+       nb_threads *= 2) {
+    std::size_t per_thread = items / nb_threads;
+    report("skiplist", nb_threads, per_thread * nb_threads,
+           bench_pq<SkiplistPq<std::uint64_t, std::uint64_t>>(nb_threads,
+                                                              per_thread));
+    report("locked_heap", nb_threads, per_thread * nb_threads,
+           bench_pq<LockedHeapPq<std::uint64_t, std::uint64_t>>(nb_threads,
+                                                                per_thread));
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Baseline priority queue: binary heap under a mutex, same interface as
+// SkiplistPq
+template <class K, class V> class LockedHeapPq {
+  using Entry = std::pair<K, V>;
+
+public:
+  LockedHeapPq() = default;
+
+  LockedHeapPq(const LockedHeapPq &) = delete;
+  LockedHeapPq &operator=(const LockedHeapPq &) = delete;
+
+  void push(K key, V val) {
+    std::lock_guard<std::mutex> lock(_mut);
+    _heap.emplace_back(std::move(key), std::move(val));
+    std::push_heap(_heap.begin(), _heap.end(), &LockedHeapPq::_after);
+  }
+
+  // Smallest key
+  bool try_pop(K &key, V &val) {
+    std::lock_guard<std::mutex> lock(_mut);
+    if (_heap.empty())
+      return false;
+
+    std::pop_heap(_heap.begin(), _heap.end(), &LockedHeapPq::_after);
+    key = std::move(_heap.back().first);
+    val = std::move(_heap.back().second);
+    _heap.pop_back();
+    return true;
+  }
+
+  bool empty() const {
+    std::lock_guard<std::mutex> lock(_mut);
+    return _heap.empty();
+  }
+
+private:
+  mutable std::mutex _mut;
+  std::vector<Entry> _heap;
+
+  // Smallest key on top
+  static bool _after(const Entry &a, const Entry &b) {
+    return b.first < a.first;
+  }
+};
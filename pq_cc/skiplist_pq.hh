@@ -0,0 +1,255 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+
+#include "../epoch/epoch.hh"
+#include "../utils/xorshift.hh"
+
+// Lock-free priority queue on a skiplist (Linden, Jonsson, 2013)
+//
+// Nodes are sorted by key, smallest first. try_pop deletes logically: it walks
+// the lowest level from the head, and claims the first node not yet deleted by
+// marking the lowest bit of the next pointer of its predecessor (one fetch_or).
+// The deleted nodes form a prefix of the list, inserts only link nodes after
+// it.
+// Deleted nodes are unlinked in batches: once a pop walked more than
+// max_offset of them, it swings the head past the prefix with one CAS, then
+// updates the upper levels of the head. Unlinked nodes are retired in the
+// epoch domain, every operation runs inside a critical section.
+// Nodes being inserted are never unlinked: the prefix stops before them, as
+// they may still be linked in upper levels.
+template <class K, class V> class SkiplistPq {
+  static constexpr std::size_t MAX_LEVEL = 24;
+
+  // Lowest bit of next[0]: the next node is deleted
+  struct Link {
+    std::atomic<bool> inserting;
+    std::atomic<std::uintptr_t> next[MAX_LEVEL];
+
+    Link() : inserting(false) {
+      for (auto &n : next)
+        n.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  // key is read by every thread walking the list, val only by the pop that
+  // claimed the node
+  struct Node : Link {
+    const K key;
+    V val;
+
+    Node(K k, V v) : key(std::move(k)), val(std::move(v)) {}
+  };
+
+public:
+  explicit SkiplistPq(std::size_t max_offset = 32) : _max_offset(max_offset) {
+    for (auto &n : _head.next)
+      n.store(_ref(&_tail), std::memory_order_relaxed);
+  }
+
+  SkiplistPq(const SkiplistPq &) = delete;
+  SkiplistPq &operator=(const SkiplistPq &) = delete;
+
+  // Unlinked nodes are freed by the epoch domain
+  ~SkiplistPq() {
+    Link *cur = _ptr(_head.next[0].load(std::memory_order_relaxed));
+    while (cur != &_tail) {
+      Link *next = _ptr(cur->next[0].load(std::memory_order_relaxed));
+      delete static_cast<Node *>(cur);
+      cur = next;
+    }
+  }
+
+  // Equal keys are popped in any order
+  void push(K key, V val) {
+    EpochGuard guard;
+    std::size_t level = _random_level();
+    Node *node = new Node(std::move(key), std::move(val));
+    node->inserting.store(true, std::memory_order_relaxed);
+
+    Link *preds[MAX_LEVEL];
+    Link *succs[MAX_LEVEL];
+    Link *del;
+    std::uintptr_t succ;
+    do {
+      del = _locate_preds(node->key, preds, succs);
+      succ = _ref(succs[0]);
+      node->next[0].store(succ, std::memory_order_relaxed);
+    } while (!preds[0]->next[0].compare_exchange_strong(
+        succ, _ref(node), std::memory_order_release,
+        std::memory_order_relaxed));
+
+    // Upper levels are only shortcuts: stops as soon as the node or its
+    // successor gets deleted
+    for (std::size_t i = 1; i < level;) {
+      succ = _ref(succs[i]);
+      node->next[i].store(succ, std::memory_order_relaxed);
+      if (_deleted_next(node) || _deleted_next(succs[i]) || succs[i] == del)
+        break;
+
+      if (preds[i]->next[i].compare_exchange_strong(succ, _ref(node),
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed))
+        ++i;
+      else {
+        del = _locate_preds(node->key, preds, succs);
+        if (succs[0] != node)
+          break;
+      }
+    }
+    node->inserting.store(false, std::memory_order_release);
+  }
+
+  // Smallest key
+  bool try_pop(K &key, V &val) {
+    EpochGuard guard;
+    Link *x = &_head;
+    std::uintptr_t obs_head = _head.next[0].load(std::memory_order_acquire);
+    Link *new_head = nullptr;
+    std::size_t offset = 0;
+
+    std::uintptr_t next;
+    do {
+      ++offset;
+      next = x->next[0].load(std::memory_order_acquire);
+      if (_ptr(next) == &_tail)
+        return false;
+      if (!new_head && x->inserting.load(std::memory_order_acquire))
+        new_head = x;
+      if (!_marked(next))
+        next = x->next[0].fetch_or(1, std::memory_order_acq_rel);
+      x = _ptr(next);
+    } while (_marked(next)); // deleted by another pop
+
+    Node *node = static_cast<Node *>(x);
+    key = node->key;
+    val = std::move(node->val);
+
+    if (!new_head)
+      new_head = x;
+    if (offset > _max_offset)
+      _unlink_prefix(obs_head, new_head);
+    return true;
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const {
+    EpochGuard guard;
+    const Link *x = &_head;
+    for (;;) {
+      std::uintptr_t next = x->next[0].load();
+      if (_ptr(next) == &_tail)
+        return true;
+      if (!_marked(next))
+        return false;
+      x = _ptr(next);
+    }
+  }
+
+private:
+  const std::size_t _max_offset;
+  Link _head;
+  Link _tail;
+
+  static Link *_ptr(std::uintptr_t ref) {
+    return reinterpret_cast<Link *>(ref & ~std::uintptr_t(1));
+  }
+
+  static bool _marked(std::uintptr_t ref) { return ref & 1; }
+
+  static std::uintptr_t _ref(Link *link) {
+    return reinterpret_cast<std::uintptr_t>(link);
+  }
+
+  // link is deleted, and isn't the last deleted node
+  static bool _deleted_next(Link *link) {
+    return _marked(link->next[0].load(std::memory_order_acquire));
+  }
+
+  bool _less(Link *link, const K &key) const {
+    return link != &_tail && static_cast<Node *>(link)->key < key;
+  }
+
+  static std::size_t _random_level() {
+    thread_local Xorshift rng(
+        std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1);
+
+    std::size_t level = 1;
+    for (auto bits = rng.next(); (bits & 1) && level < MAX_LEVEL; bits >>= 1)
+      ++level;
+    return level;
+  }
+
+  // Fills the predecessors / successors of key at each level, skipping the
+  // deleted nodes
+  // Returns the last deleted node seen in the lowest level
+  Link *_locate_preds(const K &key, Link **preds, Link **succs) {
+    Link *del = nullptr;
+    Link *x = &_head;
+
+    for (std::size_t i = MAX_LEVEL; i-- > 0;) {
+      std::uintptr_t next = x->next[i].load(std::memory_order_acquire);
+      bool d = _marked(next);
+      Link *cur = _ptr(next);
+
+      while (_less(cur, key) || (cur != &_tail && _deleted_next(cur)) ||
+             (i == 0 && d)) {
+        if (i == 0 && d)
+          del = cur;
+        x = cur;
+        next = x->next[i].load(std::memory_order_acquire);
+        d = _marked(next);
+        cur = _ptr(next);
+      }
+      preds[i] = x;
+      succs[i] = cur;
+    }
+    return del;
+  }
+
+  // obs_head: next[0] of the head at the start of the pop
+  // Nodes from obs_head to new_head (excluded) are deleted
+  void _unlink_prefix(std::uintptr_t obs_head, Link *new_head) {
+    // Another pop unlinked them first
+    if (_head.next[0].load(std::memory_order_relaxed) != obs_head ||
+        !_head.next[0].compare_exchange_strong(obs_head, _ref(new_head) | 1,
+                                               std::memory_order_acq_rel))
+      return;
+
+    _restructure();
+
+    Link *cur = _ptr(obs_head);
+    while (cur != new_head) {
+      Link *next = _ptr(cur->next[0].load(std::memory_order_relaxed));
+      epoch_retire(static_cast<Node *>(cur));
+      cur = next;
+    }
+  }
+
+  // Moves the upper levels of the head past the deleted nodes
+  void _restructure() {
+    Link *pred = &_head;
+    for (std::size_t i = MAX_LEVEL - 1; i > 0;) {
+      std::uintptr_t h = _head.next[i].load(std::memory_order_acquire);
+      if (_ptr(h) == &_tail || !_deleted_next(_ptr(h))) {
+        --i;
+        continue;
+      }
+
+      std::uintptr_t cur = pred->next[i].load(std::memory_order_acquire);
+      while (_ptr(cur) != &_tail && _deleted_next(_ptr(cur))) {
+        pred = _ptr(cur);
+        cur = pred->next[i].load(std::memory_order_acquire);
+      }
+      if (_head.next[i].compare_exchange_strong(h, cur,
+                                                std::memory_order_acq_rel))
+        --i;
+    }
+  }
+};
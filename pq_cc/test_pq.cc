@@ -0,0 +1,149 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "locked_heap_pq.hh"
+#include "skiplist_pq.hh"
+#include "xorshift.hh"
+
+namespace {
+
+constexpr std::size_t ITEMS_COUNT = 128 * 1024;
+constexpr std::size_t THREADS_COUNT = 8;
+constexpr std::size_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+struct ValCounter {
+  std::atomic<int> n;
+  char offset[64]; // to avoid false sharing
+
+  ValCounter() : n(0) {}
+};
+
+// Keys 0 to ITEMS_COUNT - 1, shuffled, the value is the key
+std::vector<std::size_t> shuffled_keys() {
+  std::vector<std::size_t> res(ITEMS_COUNT);
+  for (std::size_t i = 0; i < res.size(); ++i)
+    res[i] = i;
+
+  Xorshift xs(172847);
+  xs.shuffle(&res[0], res.size());
+  return res;
+}
+
+template <class Pq>
+void run_threads(Pq &pq, const std::vector<std::size_t> &keys,
+                 std::vector<ValCounter> &out, bool push, bool pop) {
+  std::atomic<bool> ready{false};
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+    ths.emplace_back([&, i] {
+      while (!ready)
+        continue;
+
+      const std::size_t *own_keys = &keys[i * ITEMS_PER_THREAD];
+      std::size_t key;
+      std::size_t val;
+      if (push && pop) {
+        // Each pop follows a push: never fails for long
+        for (std::size_t j = 0; j < ITEMS_PER_THREAD; ++j) {
+          pq.push(own_keys[j], own_keys[j]);
+          while (!pq.try_pop(key, val))
+            continue;
+          REQUIRE(key == val);
+          ++out[key].n;
+        }
+      } else if (push) {
+        for (std::size_t j = 0; j < ITEMS_PER_THREAD; ++j)
+          pq.push(own_keys[j], own_keys[j]);
+      } else {
+        // Nothing pushed meanwhile: each thread sees increasing keys
+        bool first = true;
+        std::size_t prev = 0;
+        while (pq.try_pop(key, val)) {
+          REQUIRE(key == val);
+          REQUIRE((first || prev < key));
+          first = false;
+          prev = key;
+          ++out[key].n;
+        }
+      }
+    });
+
+  ready = true;
+  for (auto &t : ths)
+    t.join();
+}
+
+} // namespace
+
+TEMPLATE_TEST_CASE("pq pops the smallest key", "",
+                   (SkiplistPq<std::size_t, std::size_t>),
+                   (LockedHeapPq<std::size_t, std::size_t>)) {
+  TestType pq;
+  std::size_t key;
+  std::size_t val;
+  REQUIRE(pq.empty());
+  REQUIRE(!pq.try_pop(key, val));
+
+  auto keys = shuffled_keys();
+  for (auto k : keys)
+    pq.push(k, k);
+  REQUIRE(!pq.empty());
+
+  // Smaller keys pushed while popping come out first
+  for (std::size_t i = 0; i < ITEMS_COUNT; ++i) {
+    REQUIRE(pq.try_pop(key, val));
+    REQUIRE(key == i);
+    REQUIRE(val == i);
+
+    if (i % 1024 == 0) {
+      pq.push(i, 42);
+      pq.push(i, 42);
+      for (int j = 0; j < 2; ++j) {
+        REQUIRE(pq.try_pop(key, val));
+        REQUIRE(key == i);
+        REQUIRE(val == 42);
+      }
+    }
+  }
+  REQUIRE(!pq.try_pop(key, val));
+  REQUIRE(pq.empty());
+
+  // Values still inside are destroyed with the queue
+  for (std::size_t i = 0; i < 100; ++i)
+    pq.push(i, i);
+}
+
+TEMPLATE_TEST_CASE("pq N threads push / pop", "",
+                   (SkiplistPq<std::size_t, std::size_t>),
+                   (LockedHeapPq<std::size_t, std::size_t>)) {
+  TestType pq;
+  auto keys = shuffled_keys();
+  std::vector<ValCounter> out(ITEMS_COUNT);
+
+  run_threads(pq, keys, out, true, true);
+
+  REQUIRE(pq.empty());
+  for (const auto &x : out)
+    REQUIRE(x.n == 1);
+}
+
+TEMPLATE_TEST_CASE("pq N threads push, then N threads pop", "",
+                   (SkiplistPq<std::size_t, std::size_t>),
+                   (LockedHeapPq<std::size_t, std::size_t>)) {
+  TestType pq;
+  auto keys = shuffled_keys();
+  std::vector<ValCounter> out(ITEMS_COUNT);
+
+  run_threads(pq, keys, out, true, false);
+  run_threads(pq, keys, out, false, true);
+
+  REQUIRE(pq.empty());
+  for (const auto &x : out)
+    REQUIRE(x.n == 1);
+}
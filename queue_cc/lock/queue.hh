@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "../../stack_cc/chain_release.hh"
+
+template <class T> class Queue {
+
+  struct Node {
+    T val;
+    std::shared_ptr<Node> next;
+
+    Node(const T &val) : val(val) {}
+
+    ~Node() { release_chain(std::move(next)); }
+  };
+
+public:
+  using ref_t = std::shared_ptr<T>;
+
+  Queue() = default;
+
+  Queue(const Queue &) = delete;
+  Queue &operator=(const Queue &) = delete;
+
+  std::shared_ptr<T> push(const T &val) {
+    auto node = std::make_shared<Node>(val);
+
+    std::lock_guard<std::mutex> lock(_mut);
+    if (_tail)
+      _tail->next = node;
+    else
+      _head = node;
+    _tail = node;
+    return std::shared_ptr<T>(node, &node->val);
+  }
+
+  std::shared_ptr<T> try_pop() {
+    std::lock_guard<std::mutex> lock(_mut);
+    if (!_head)
+      return nullptr;
+
+    std::shared_ptr<T> res(_head, &_head->val);
+    auto next = std::move(_head->next);
+    _head = std::move(next);
+    if (!_head)
+      _tail = nullptr;
+    return res;
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const {
+    std::lock_guard<std::mutex> lock(_mut);
+    return !_head;
+  }
+
+private:
+  mutable std::mutex _mut;
+  std::shared_ptr<Node> _head;
+  std::shared_ptr<Node> _tail;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../my_shared_ptr/spinlock.hh"
+
+// Link embedded in the elements of an IntrusiveMpscQueue
+struct MpscHook {
+  std::atomic<MpscHook *> next;
+
+  MpscHook() : next(nullptr) {}
+};
+
+// Intrusive MPSC queue (Dmitry Vyukov): any thread pushes, a single consumer
+// pops, FIFO
+//
+// push is wait-free: one exchange on the tail, then a store to link the
+// previous tail to the element. Until that store, the consumer can't reach the
+// element, nor the ones pushed after it: try_pop may see the queue empty while
+// a push is in progress, and just has to try again.
+// A stub element keeps the list from ever being empty: the consumer pushes it
+// back to take the last element.
+// The queue doesn't own its elements, T must derive from MpscHook.
+template <class T> class IntrusiveMpscQueue {
+  static_assert(std::is_base_of<MpscHook, T>::value,
+                "IntrusiveMpscQueue elements must derive from MpscHook");
+
+public:
+  IntrusiveMpscQueue() : _tail(&_stub), _head(&_stub) {}
+
+  IntrusiveMpscQueue(const IntrusiveMpscQueue &) = delete;
+  IntrusiveMpscQueue &operator=(const IntrusiveMpscQueue &) = delete;
+
+  // Any thread
+  void push(T *elem) { _push(elem); }
+
+  // Consumer only
+  // nullptr if empty, or if the next element isn't linked yet
+  T *try_pop() {
+    MpscHook *head = _head;
+    MpscHook *next = head->next.load(std::memory_order_acquire);
+
+    if (head == &_stub) {
+      if (!next)
+        return nullptr;
+      _head = next;
+      head = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+      _head = next;
+      return static_cast<T *>(head);
+    }
+
+    // head is the last element: a push is in progress, or the stub must be
+    // pushed behind it before taking it
+    if (head != _tail.load(std::memory_order_acquire))
+      return nullptr;
+
+    _push(&_stub);
+    next = head->next.load(std::memory_order_acquire);
+    if (!next)
+      return nullptr;
+
+    _head = next;
+    return static_cast<T *>(head);
+  }
+
+  // Consumer only, an element being pushed counts
+  bool empty() const {
+    return _head == &_stub && _tail.load(std::memory_order_acquire) == &_stub;
+  }
+
+private:
+  // Producers exchange the tail, the consumer owns the head
+  alignas(64) std::atomic<MpscHook *> _tail;
+  alignas(64) MpscHook *_head;
+  MpscHook _stub;
+
+  void _push(MpscHook *elem) {
+    elem->next.store(nullptr, std::memory_order_relaxed);
+    MpscHook *prev = _tail.exchange(elem, std::memory_order_acq_rel);
+    prev->next.store(elem, std::memory_order_release);
+  }
+};
+
+// MPSC queue owning copies of its values, on top of IntrusiveMpscQueue
+//
+// Nodes popped by the consumer are kept in a free list, and reused by the next
+// pushes instead of allocating. The consumer pushes to the free list with a
+// CAS. Producers pop from it under a try-lock: a single thread pops at a time,
+// so no ABA, and a producer finding the lock taken allocates a new node
+// instead of waiting.
+template <class T> class MpscQueue {
+
+  // The value is only alive while the node is queued
+  struct Node : MpscHook {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+
+    T *get_ptr() { return reinterpret_cast<T *>(&data); }
+  };
+
+public:
+  MpscQueue() : _free(nullptr), _nodes_count(0) {}
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  ~MpscQueue() {
+    while (Node *node = _queue.try_pop()) {
+      node->get_ptr()->~T();
+      delete node;
+    }
+
+    Node *node = _free.load(std::memory_order_acquire);
+    while (node) {
+      Node *next = _next_free(node);
+      delete node;
+      node = next;
+    }
+  }
+
+  // Any thread
+
+  void push(const T &val) { emplace(val); }
+
+  void push(T &&val) { emplace(std::move(val)); }
+
+  template <class... Args> void emplace(Args &&... args) {
+    Node *node = _take_free();
+    if (!node) {
+      node = new Node;
+      _nodes_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    try {
+      new (node->get_ptr()) T(std::forward<Args>(args)...);
+    } catch (...) {
+      _put_free(node);
+      throw;
+    }
+    _queue.push(node);
+  }
+
+  // Consumer only
+
+  bool try_pop(T &val) {
+    Node *node = _queue.try_pop();
+    if (!node)
+      return false;
+
+    val = std::move(*node->get_ptr());
+    node->get_ptr()->~T();
+    _put_free(node);
+    return true;
+  }
+
+  bool empty() const { return _queue.empty(); }
+
+  // Here for debug / test: number of nodes allocated, queued or free
+  std::size_t nodes_count() const {
+    return _nodes_count.load(std::memory_order_relaxed);
+  }
+
+private:
+  IntrusiveMpscQueue<Node> _queue;
+
+  // Free nodes, linked with MpscHook::next
+  alignas(64) std::atomic<Node *> _free;
+  TtasLock _free_lock;
+  std::atomic<std::size_t> _nodes_count;
+
+  static Node *_next_free(Node *node) {
+    return static_cast<Node *>(node->next.load(std::memory_order_relaxed));
+  }
+
+  Node *_take_free() {
+    if (!_free.load(std::memory_order_relaxed) || !_free_lock.try_lock())
+      return nullptr;
+
+    // Nodes are only pushed meanwhile: the next of the head can't change
+    Node *node = _free.load(std::memory_order_acquire);
+    while (node && !_free.compare_exchange_weak(node, _next_free(node),
+                                                std::memory_order_acquire,
+                                                std::memory_order_acquire))
+      continue;
+
+    _free_lock.unlock();
+    return node;
+  }
+
+  void _put_free(Node *node) {
+    Node *head = _free.load(std::memory_order_relaxed);
+    do
+      node->next.store(head, std::memory_order_relaxed);
+    while (!_free.compare_exchange_weak(head, node, std::memory_order_release,
+                                        std::memory_order_relaxed));
+  }
+};
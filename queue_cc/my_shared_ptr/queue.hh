@@ -0,0 +1,96 @@
+#pragma once
+
+#include <optional>
+
+#include "../../my_shared_ptr/my_atomic_shared_ptr.hh"
+#include "../../stack_cc/chain_release.hh"
+
+// Michael-Scott queue
+// The head is a dummy node, the values are stored in the nodes after it
+// The tail may lag one node behind, every thread helps moving it forward
+// Popped nodes are unlinked from the queue (next set to a dead node), so that a
+// value held by the user doesn't keep alive all the nodes pushed after it
+template <class T> class Queue {
+
+  struct Node {
+    std::optional<T> val;
+    my_atomic_shared_ptr<Node> next;
+
+    Node() = default;
+    Node(const T &val) : val(val) {}
+
+    // No other owner left, nothing races with the exchange
+    ~Node() { release_chain(next.exchange(nullptr)); }
+  };
+
+public:
+  using ref_t = my_shared_ptr<T>;
+
+  Queue() : Queue(make_my_shared<Node>()) {}
+
+  Queue(const Queue &) = delete;
+  Queue &operator=(const Queue &) = delete;
+
+  my_shared_ptr<T> push(const T &val) {
+    auto node = make_my_shared<Node>(val);
+
+    for (;;) {
+      my_shared_ptr<Node> tail = _tail.load();
+      my_shared_ptr<Node> next = tail->next.load();
+
+      // Tail popped in between
+      if (next == _dead)
+        continue;
+
+      if (next) {
+        _tail.compare_exchange(tail, next);
+        continue;
+      }
+
+      if (tail->next.compare_exchange(next, node)) {
+        _tail.compare_exchange(tail, node);
+        break;
+      }
+    }
+
+    return my_shared_ptr<T>(node, &*node->val);
+  }
+
+  my_shared_ptr<T> try_pop() {
+    for (;;) {
+      my_shared_ptr<Node> head = _head.load();
+      my_shared_ptr<Node> next = head->next.load();
+      if (next == _dead)
+        continue;
+      if (!next)
+        return nullptr;
+
+      // Never move the head past the tail
+      my_shared_ptr<Node> tail = _tail.load();
+      if (head == tail) {
+        _tail.compare_exchange(tail, next);
+        continue;
+      }
+
+      // next becomes the dummy, its value is kept alive with the node
+      if (_head.compare_exchange(head, next)) {
+        // Only changed by the pop that moved the head
+        my_shared_ptr<Node> exp = next;
+        head->next.compare_exchange(exp, _dead);
+        return my_shared_ptr<T>(next, &*next->val);
+      }
+    }
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return !_head.load()->next; }
+
+private:
+  my_atomic_shared_ptr<Node> _head;
+  my_atomic_shared_ptr<Node> _tail;
+  const my_shared_ptr<Node> _dead;
+
+  Queue(const my_shared_ptr<Node> &dummy)
+      : _head(dummy), _tail(dummy), _dead(make_my_shared<Node>()) {}
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#if defined(IMPL_LOCK)
+#include "lock/queue.hh"
+
+#elif defined(IMPL_SHARED_PTR)
+#include "shared_ptr/queue.hh"
+
+#elif defined(IMPL_MY_SHARED_PTR)
+#include "my_shared_ptr/queue.hh"
+
+#endif
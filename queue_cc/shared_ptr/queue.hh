@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "../../stack_cc/chain_release.hh"
+
+// Michael-Scott queue
+// The head is a dummy node, the values are stored in the nodes after it
+// The tail may lag one node behind, every thread helps moving it forward
+// Popped nodes are unlinked from the queue (next set to a dead node), so that a
+// value held by the user doesn't keep alive all the nodes pushed after it
+template <class T> class Queue {
+
+  struct Node {
+    std::optional<T> val;
+    std::shared_ptr<Node> next;
+
+    Node() = default;
+    Node(const T &val) : val(val) {}
+
+    ~Node() { release_chain(std::move(next)); }
+  };
+
+public:
+  using ref_t = std::shared_ptr<T>;
+
+  Queue()
+      : _head(std::make_shared<Node>()), _tail(_head),
+        _dead(std::make_shared<Node>()) {}
+
+  Queue(const Queue &) = delete;
+  Queue &operator=(const Queue &) = delete;
+
+  std::shared_ptr<T> push(const T &val) {
+    auto node = std::make_shared<Node>(val);
+
+    for (;;) {
+      std::shared_ptr<Node> tail = std::atomic_load(&_tail);
+      std::shared_ptr<Node> next = std::atomic_load(&tail->next);
+
+      // Tail popped in between
+      if (next == _dead)
+        continue;
+
+      if (next) {
+        std::atomic_compare_exchange_weak(&_tail, &tail, next);
+        continue;
+      }
+
+      if (std::atomic_compare_exchange_weak(&tail->next, &next, node)) {
+        std::atomic_compare_exchange_strong(&_tail, &tail, node);
+        break;
+      }
+    }
+
+    return std::shared_ptr<T>(node, &*node->val);
+  }
+
+  std::shared_ptr<T> try_pop() {
+    for (;;) {
+      std::shared_ptr<Node> head = std::atomic_load(&_head);
+      std::shared_ptr<Node> next = std::atomic_load(&head->next);
+      if (next == _dead)
+        continue;
+      if (!next)
+        return nullptr;
+
+      // Never move the head past the tail
+      std::shared_ptr<Node> tail = std::atomic_load(&_tail);
+      if (head == tail) {
+        std::atomic_compare_exchange_weak(&_tail, &tail, next);
+        continue;
+      }
+
+      // next becomes the dummy, its value is kept alive with the node
+      if (std::atomic_compare_exchange_weak(&_head, &head, next)) {
+        std::atomic_store(&head->next, _dead);
+        return std::shared_ptr<T>(next, &*next->val);
+      }
+    }
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return !std::atomic_load(&_head)->next; }
+
+private:
+  std::shared_ptr<Node> _head;
+  std::shared_ptr<Node> _tail;
+  const std::shared_ptr<Node> _dead;
+};
@@ -0,0 +1,77 @@
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "queue.hh"
+
+namespace {
+
+constexpr std::uint64_t ITEMS_COUNT = 512 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 16;
+constexpr std::uint64_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+struct ValCounter {
+  std::atomic<int> n;
+  char offset[64]; // to avoid false sharing
+
+  ValCounter() : n(0) {}
+};
+
+std::unique_ptr<std::vector<ValCounter>> g_out;
+
+Queue<std::uint64_t> g_queue;
+std::atomic<bool> g_ready;
+
+void runner_produce(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; ++i)
+    g_queue.push(i << 32 | tid);
+}
+
+void runner_consume() {
+  while (!g_ready)
+    continue;
+
+  // FIFO: values of one producer are popped in the order they were pushed
+  std::vector<std::uint64_t> next_min(THREADS_COUNT, 0);
+
+  for (std::size_t i = 0; i < ITEMS_PER_THREAD; ++i) {
+    Queue<std::uint64_t>::ref_t next;
+    while (!(next = g_queue.try_pop()))
+      continue;
+
+    std::uint64_t tid = *next & 0xFFFFFFFF;
+    std::uint64_t val = *next >> 32;
+    REQUIRE(val >= next_min[tid]);
+    next_min[tid] = val + 1;
+    ++((*g_out)[tid * ITEMS_PER_THREAD + val].n);
+  }
+}
+
+} // namespace
+
+TEST_CASE("Test N consumer + N producer") {
+  g_ready = false;
+  g_out = std::make_unique<std::vector<ValCounter>>(ITEMS_COUNT);
+
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i) {
+    ths.emplace_back(runner_produce, i);
+    ths.emplace_back(runner_consume);
+  }
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(g_queue.empty());
+  for (const auto &x : *g_out)
+    REQUIRE(x.n == 1);
+}
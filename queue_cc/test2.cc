@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+#include "queue.hh"
+
+namespace {
+constexpr std::uint64_t ITEMS_COUNT = 1 * 1024 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 16;
+constexpr std::uint64_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+Queue<std::uint64_t> g_queue;
+std::atomic<bool> g_ready;
+
+std::array<std::atomic<std::size_t>, THREADS_COUNT> g_counts;
+
+void runner_produce(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; ++i)
+    g_queue.push(i << 32 | tid);
+}
+
+void runner_consume() {
+  while (!g_ready)
+    continue;
+
+  std::vector<std::size_t> counts(THREADS_COUNT, 0);
+
+  std::vector<std::uint64_t> next_min(THREADS_COUNT, 0);
+  for (;;) {
+    auto next = g_queue.try_pop();
+    if (!next)
+      break;
+
+    std::uint64_t tid = *next & 0xFFFFFFFF;
+    std::uint64_t val = *next >> 32;
+    REQUIRE(val >= next_min[tid]);
+    next_min[tid] = val + 1;
+    ++counts[tid];
+  }
+
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+    g_counts[i] += counts[i];
+}
+
+} // namespace
+
+TEST_CASE("push then pop in FIFO order") {
+  Queue<int> queue;
+  REQUIRE(queue.empty());
+  REQUIRE(!queue.try_pop());
+
+  for (int i = 0; i < 100; ++i)
+    REQUIRE(*queue.push(i) == i);
+  REQUIRE(!queue.empty());
+
+  for (int i = 0; i < 100; ++i) {
+    auto next = queue.try_pop();
+    REQUIRE(next);
+    REQUIRE(*next == i);
+  }
+  REQUIRE(queue.empty());
+  REQUIRE(!queue.try_pop());
+}
+
+TEST_CASE("N producers, then N consumers") {
+
+  {
+    g_ready = false;
+    std::vector<std::thread> ths;
+    for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+      ths.emplace_back(runner_produce, i);
+
+    g_ready = true;
+    for (auto &t : ths)
+      t.join();
+  }
+
+  std::fill(g_counts.begin(), g_counts.end(), 0);
+
+  {
+    g_ready = false;
+    std::vector<std::thread> ths;
+    for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+      ths.emplace_back(runner_consume);
+
+    g_ready = true;
+    for (auto &t : ths)
+      t.join();
+  }
+
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+    REQUIRE(g_counts[i] == ITEMS_PER_THREAD);
+  REQUIRE(g_queue.empty());
+}
@@ -0,0 +1,160 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpsc_queue.hh"
+
+namespace {
+constexpr std::uint64_t ITEMS_COUNT = 1 * 1024 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 8;
+constexpr std::uint64_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+struct Item : MpscHook {
+  std::uint64_t val;
+};
+
+std::atomic<bool> g_ready;
+
+// Values: i << 32 | tid, each producer pushes in increasing order
+template <class Push> void run_producers(Push push) {
+  std::vector<std::thread> ths;
+  for (std::size_t tid = 0; tid < THREADS_COUNT; ++tid)
+    ths.emplace_back([&push, tid] {
+      while (!g_ready)
+        continue;
+
+      for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; ++i)
+        push(tid, i << 32 | tid);
+    });
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+}
+
+// FIFO for each producer, every value popped once
+template <class TryPop> void consume_all(TryPop try_pop) {
+  std::vector<std::uint64_t> next_val(THREADS_COUNT, 0);
+  std::uint64_t val;
+  for (std::uint64_t n = 0; n < ITEMS_COUNT; ++n) {
+    while (!try_pop(val))
+      continue;
+
+    std::uint64_t tid = val & 0xFFFFFFFF;
+    REQUIRE(val >> 32 == next_val[tid]);
+    ++next_val[tid];
+  }
+  for (auto x : next_val)
+    REQUIRE(x == ITEMS_PER_THREAD);
+}
+} // namespace
+
+TEST_CASE("intrusive mpsc FIFO") {
+  IntrusiveMpscQueue<Item> queue;
+  std::vector<Item> items(100);
+  REQUIRE(queue.empty());
+  REQUIRE(!queue.try_pop());
+
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    items[i].val = i;
+    queue.push(&items[i]);
+  }
+  REQUIRE(!queue.empty());
+
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    Item *item = queue.try_pop();
+    REQUIRE(item == &items[i]);
+  }
+  REQUIRE(!queue.try_pop());
+  REQUIRE(queue.empty());
+
+  // Pops the last element each time: the stub goes back behind it
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    queue.push(&items[i]);
+    REQUIRE(queue.try_pop() == &items[i]);
+    REQUIRE(!queue.try_pop());
+  }
+  REQUIRE(queue.empty());
+}
+
+TEST_CASE("intrusive mpsc N producers + 1 consumer") {
+  IntrusiveMpscQueue<Item> queue;
+  std::vector<Item> items(ITEMS_COUNT);
+
+  g_ready = false;
+  std::thread consumer([&] {
+    consume_all([&](std::uint64_t &val) {
+      Item *item = queue.try_pop();
+      if (item)
+        val = item->val;
+      return item != nullptr;
+    });
+  });
+
+  // Each producer pushes its own items
+  run_producers([&](std::size_t tid, std::uint64_t val) {
+    Item &item = items[(val >> 32) * THREADS_COUNT + tid];
+    item.val = val;
+    queue.push(&item);
+  });
+  consumer.join();
+
+  REQUIRE(queue.empty());
+}
+
+TEST_CASE("mpsc values, nodes recycled") {
+  MpscQueue<std::string> queue;
+  std::string val;
+  REQUIRE(queue.empty());
+  REQUIRE(!queue.try_pop(val));
+
+  for (int i = 0; i < 100; ++i)
+    queue.push(std::to_string(i));
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE(queue.try_pop(val));
+    REQUIRE(val == std::to_string(i));
+  }
+  REQUIRE(!queue.try_pop(val));
+  REQUIRE(queue.nodes_count() == 100);
+
+  // Popped nodes are reused
+  for (int lap = 0; lap < 10; ++lap) {
+    for (int i = 0; i < 100; ++i)
+      queue.emplace(3, 'a' + i % 26);
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(queue.try_pop(val));
+      REQUIRE(val == std::string(3, 'a' + i % 26));
+    }
+  }
+  REQUIRE(queue.nodes_count() == 100);
+  REQUIRE(queue.empty());
+
+  // Values still inside are destroyed with the queue
+  auto shared = std::make_shared<int>(3);
+  {
+    MpscQueue<std::shared_ptr<int>> queue_ptr;
+    for (int i = 0; i < 10; ++i)
+      queue_ptr.push(shared);
+    REQUIRE(shared.use_count() == 11);
+  }
+  REQUIRE(shared.use_count() == 1);
+}
+
+TEST_CASE("mpsc values N producers + 1 consumer") {
+  MpscQueue<std::uint64_t> queue;
+
+  g_ready = false;
+  std::thread consumer([&] {
+    consume_all([&](std::uint64_t &val) { return queue.try_pop(val); });
+  });
+
+  run_producers([&](std::size_t, std::uint64_t val) { queue.push(val); });
+  consumer.join();
+
+  REQUIRE(queue.empty());
+  REQUIRE(queue.nodes_count() <= ITEMS_COUNT);
+}
@@ -0,0 +1,34 @@
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <memory>
+
+#include "queue.hh"
+
+// Destroying a long chain must not recurse node by node: the call stack
+// would overflow long before the end
+namespace {
+constexpr std::uint32_t ITEMS_COUNT = 4 * 1024 * 1024;
+
+void fill(Queue<std::uint32_t> &queue) {
+  for (std::uint32_t i = 0; i < ITEMS_COUNT; ++i)
+    queue.push(i);
+}
+} // namespace
+
+TEST_CASE("destroy a queue of millions of values") {
+  auto queue = std::make_unique<Queue<std::uint32_t>>();
+  fill(*queue);
+  REQUIRE(!queue->empty());
+  queue.reset();
+}
+
+// The handle owns the node of the value, and all the nodes pushed after it
+TEST_CASE("drop the last handle to a long queue") {
+  auto queue = std::make_unique<Queue<std::uint32_t>>();
+  auto first = queue->push(0);
+  for (std::uint32_t i = 1; i < ITEMS_COUNT; ++i)
+    queue->push(i);
+
+  queue.reset();
+  REQUIRE(*first == 0);
+}
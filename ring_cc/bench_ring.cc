@@ -0,0 +1,189 @@
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../stack_cc/stack.hh"
+#include "mpmc_ring.hh"
+#include "spsc_ring.hh"
+
+// N producers + N consumers moving items through the ring, and through the
+// linked Stack selected with IMPL_*
+// With 1 producer, also through the SPSC ring, one item or one batch at a time
+// Ping-pong: 2 threads and 2 channels (SPSC rings, then Stacks), one value at a
+// time, each side waits for the reply before sending the next value
+// Output: CSV, one line per structure and number of threads
+
+namespace {
+
+constexpr std::size_t RING_CAPACITY = 1024;
+constexpr std::size_t SPSC_BATCH = 64;
+// Round trips are much slower than streaming, fewer of them
+constexpr std::size_t PING_PONG_DIV = 16;
+
+std::atomic<bool> g_ready;
+
+template <class F> double timed_run(std::size_t nb_threads, F fun) {
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < nb_threads; ++i)
+    ths.emplace_back([&fun, i] {
+      while (!g_ready)
+        continue;
+      fun(i);
+    });
+
+  auto start = std::chrono::steady_clock::now();
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  std::chrono::duration<double> dur = std::chrono::steady_clock::now() - start;
+  return dur.count();
+}
+
+double bench_ring(std::size_t nb_threads, std::size_t items_per_thread) {
+  MpmcRing<std::uint64_t> ring(RING_CAPACITY);
+
+  return timed_run(2 * nb_threads, [&](std::size_t tid) {
+    if (tid % 2 == 0) {
+      for (std::uint64_t i = 0; i < items_per_thread; ++i)
+        while (!ring.try_push(i))
+          std::this_thread::yield();
+    } else {
+      std::uint64_t val;
+      for (std::size_t i = 0; i < items_per_thread; ++i)
+        while (!ring.try_pop(val))
+          std::this_thread::yield();
+    }
+  });
+}
+
+double bench_spsc(std::size_t items, std::size_t batch) {
+  SpscRing<std::uint64_t> ring(RING_CAPACITY);
+
+  return timed_run(2, [&](std::size_t tid) {
+    std::uint64_t buf[SPSC_BATCH] = {};
+    for (std::size_t i = 0; i < items;) {
+      std::size_t n = std::min(batch, items - i);
+      n = tid == 0 ? ring.push_n(buf, n) : ring.pop_n(buf, n);
+      if (!n)
+        std::this_thread::yield();
+      i += n;
+    }
+  });
+}
+
+bool try_send(SpscRing<std::uint64_t> &ring, std::uint64_t val) {
+  return ring.try_push(val);
+}
+
+bool try_recv(SpscRing<std::uint64_t> &ring, std::uint64_t &val) {
+  return ring.try_pop(val);
+}
+
+bool try_send(Stack<std::uint64_t> &stack, std::uint64_t val) {
+  stack.push(val);
+  return true;
+}
+
+bool try_recv(Stack<std::uint64_t> &stack, std::uint64_t &val) {
+  auto next = stack.try_pop();
+  if (!next)
+    return false;
+  val = *next;
+  return true;
+}
+
+// Thread 0 sends on ping and waits on pong, thread 1 echoes each value back
+template <class Channel>
+double bench_ping_pong(Channel &ping, Channel &pong, std::size_t rounds) {
+  return timed_run(2, [&](std::size_t tid) {
+    Channel &in = tid == 0 ? pong : ping;
+    Channel &out = tid == 0 ? ping : pong;
+
+    std::uint64_t val = 0;
+    for (std::size_t i = 0; i < rounds; ++i) {
+      if (tid == 0)
+        val = i;
+      else
+        while (!try_recv(in, val))
+          std::this_thread::yield();
+
+      while (!try_send(out, val))
+        std::this_thread::yield();
+
+      if (tid == 0)
+        while (!try_recv(in, val))
+          std::this_thread::yield();
+    }
+  });
+}
+
+double bench_spsc_ping_pong(std::size_t rounds) {
+  SpscRing<std::uint64_t> ping(RING_CAPACITY);
+  SpscRing<std::uint64_t> pong(RING_CAPACITY);
+  return bench_ping_pong(ping, pong, rounds);
+}
+
+double bench_stack_ping_pong(std::size_t rounds) {
+  Stack<std::uint64_t> ping;
+  Stack<std::uint64_t> pong;
+  return bench_ping_pong(ping, pong, rounds);
+}
+
+double bench_stack(std::size_t nb_threads, std::size_t items_per_thread) {
+  Stack<std::uint64_t> stack;
+
+  return timed_run(2 * nb_threads, [&](std::size_t tid) {
+    if (tid % 2 == 0) {
+      for (std::uint64_t i = 0; i < items_per_thread; ++i)
+        stack.push(i);
+    } else {
+      for (std::size_t i = 0; i < items_per_thread; ++i)
+        while (!stack.try_pop())
+          std::this_thread::yield();
+    }
+  });
+}
+
+void report(const char *structure, std::size_t nb_threads, std::size_t items,
+            double dur) {
+  // push + pop for each item
+  std::cout << structure << "," << IMPL_NAME << "," << nb_threads << ","
+            << static_cast<std::uint64_t>(2 * items / dur) << std::endl;
+}
+
+} // namespace
+
+// Usage: bench_ring_<impl>.bin [max_producers] [items]
+int main(int argc, char **argv) {
+  std::size_t max_threads =
+      argc > 1 ? std::stoul(argv[1])
+               : std::max(1u, std::thread::hardware_concurrency() / 2);
+  std::size_t items = argc > 2 ? std::stoul(argv[2]) : 1024 * 1024;
+
+  std::cout << "structure,impl,producers,ops_per_sec" << std::endl;
+  for (std::size_t nb_threads = 1; nb_threads <= max_threads;
+       nb_threads *= 2) {
+    std::size_t per_thread = items / nb_threads;
+    report("mpmc_ring", nb_threads, per_thread * nb_threads,
+           bench_ring(nb_threads, per_thread));
+    if (nb_threads == 1) {
+      report("spsc_ring", 1, items, bench_spsc(items, 1));
+      report("spsc_ring_batch", 1, items, bench_spsc(items, SPSC_BATCH));
+
+      // Each round trip moves 2 items
+      std::size_t rounds = items / PING_PONG_DIV;
+      report("spsc_ring_ping_pong", 1, 2 * rounds,
+             bench_spsc_ping_pong(rounds));
+      report("stack_ping_pong", 1, 2 * rounds, bench_stack_ping_pong(rounds));
+    }
+    report("stack", nb_threads, per_thread * nb_threads,
+           bench_stack(nb_threads, per_thread));
+  }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Bounded MPMC queue (Dmitry Vyukov)
+//
+// Fixed array of cells, each with a sequence number:
+// - seq == pos: free, can be written by the push at pos
+// - seq == pos + 1: full, can be read by the pop at pos
+// After a pop, seq is set to pos + capacity, the push of the next lap.
+// push / pop only contend on their own index, with a single CAS, and never
+// allocate after construction.
+template <class T> class MpmcRing {
+
+  struct Cell {
+    std::atomic<std::size_t> seq;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+
+    T *get_ptr() { return reinterpret_cast<T *>(&data); }
+  };
+
+public:
+  // capacity must be a power of 2
+  explicit MpmcRing(std::size_t capacity)
+      : _cells(new Cell[capacity]), _mask(capacity - 1), _tail(0), _head(0) {
+    if (capacity < 2 || (capacity & _mask))
+      throw std::invalid_argument{"MpmcRing capacity must be a power of 2"};
+
+    for (std::size_t i = 0; i < capacity; ++i)
+      _cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  MpmcRing(const MpmcRing &) = delete;
+  MpmcRing &operator=(const MpmcRing &) = delete;
+
+  ~MpmcRing() {
+    for (std::size_t pos = _head.load(); pos != _tail.load(); ++pos)
+      _cells[pos & _mask].get_ptr()->~T();
+  }
+
+  bool try_push(const T &val) { return _try_push(val); }
+
+  bool try_push(T &&val) { return _try_push(std::move(val)); }
+
+  // Same as push: once the CAS on _head succeeds, the cell must be released or
+  // pushes at the next lap would see the ring full forever
+  bool try_pop(T &val) {
+    static_assert(std::is_nothrow_move_assignable_v<T>,
+                  "MpmcRing requires a nothrow move assignment");
+    std::size_t pos = _head.load(std::memory_order_relaxed);
+    Cell *cell;
+
+    for (;;) {
+      cell = &_cells[pos & _mask];
+      std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq - (pos + 1));
+
+      if (diff == 0) {
+        if (_head.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0)
+        return false; // empty
+      else
+        pos = _head.load(std::memory_order_relaxed);
+    }
+
+    val = std::move(*cell->get_ptr());
+    cell->get_ptr()->~T();
+    cell->seq.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t capacity() const { return _mask + 1; }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return _head.load() == _tail.load(); }
+
+private:
+  const std::unique_ptr<Cell[]> _cells;
+  const std::size_t _mask;
+
+  // Each index on its own cache line, producers and consumers don't share
+  alignas(64) std::atomic<std::size_t> _tail;
+  alignas(64) std::atomic<std::size_t> _head;
+
+  // A constructor that may throw runs before the slot is claimed: once the
+  // CAS on _tail succeeds, the cell must be published or pops at pos would
+  // spin on it forever
+  template <class U> bool _try_push(U &&val) {
+    if constexpr (std::is_nothrow_constructible_v<T, U &&>)
+      return _try_emplace(std::forward<U>(val));
+    else {
+      static_assert(std::is_nothrow_move_constructible_v<T>,
+                    "MpmcRing requires a nothrow move constructor");
+      T tmp(std::forward<U>(val));
+      return _try_emplace(std::move(tmp));
+    }
+  }
+
+  template <class U> bool _try_emplace(U &&val) {
+    static_assert(std::is_nothrow_constructible_v<T, U &&>);
+    std::size_t pos = _tail.load(std::memory_order_relaxed);
+    Cell *cell;
+
+    for (;;) {
+      cell = &_cells[pos & _mask];
+      std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq - pos);
+
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0)
+        return false; // full
+      else
+        pos = _tail.load(std::memory_order_relaxed);
+    }
+
+    new (cell->get_ptr()) T(std::forward<U>(val));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+};
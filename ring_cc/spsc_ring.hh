@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Bounded SPSC queue: one producer thread, one consumer thread, wait-free
+//
+// tail is only written by the producer, head only by the consumer.
+// Each side keeps a cached copy of the other side's index, on its own cache
+// line: the shared index is only read again when the cached one says the
+// ring is full (producer) or empty (consumer).
+// push_n / pop_n move a whole batch, then publish it with a single release
+// store of the index.
+template <class T> class SpscRing {
+
+  struct Cell {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+
+    T *get_ptr() { return reinterpret_cast<T *>(&data); }
+  };
+
+public:
+  // capacity must be a power of 2
+  explicit SpscRing(std::size_t capacity)
+      : _cells(new Cell[capacity]), _mask(capacity - 1), _tail(0),
+        _head_cache(0), _head(0), _tail_cache(0) {
+    if (capacity < 2 || (capacity & _mask))
+      throw std::invalid_argument{"SpscRing capacity must be a power of 2"};
+  }
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  ~SpscRing() {
+    for (std::size_t pos = _head.load(); pos != _tail.load(); ++pos)
+      _cells[pos & _mask].get_ptr()->~T();
+  }
+
+  // Producer side
+
+  bool try_push(const T &val) { return _try_push(val); }
+
+  bool try_push(T &&val) { return _try_push(std::move(val)); }
+
+  // Copies up to n values from first, returns the number pushed
+  // Use std::make_move_iterator to move them
+  // If a copy throws, nothing is pushed: the values built are destroyed
+  template <class InputIt> std::size_t push_n(InputIt first, std::size_t n) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    n = std::min(n, _free(tail, n));
+
+    std::size_t i = 0;
+    try {
+      for (; i < n; ++i, ++first)
+        new (_cells[(tail + i) & _mask].get_ptr()) T(*first);
+    } catch (...) {
+      while (i-- > 0)
+        _cells[(tail + i) & _mask].get_ptr()->~T();
+      throw;
+    }
+
+    _tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Consumer side
+
+  bool try_pop(T &val) { return pop_n(&val, 1) == 1; }
+
+  // Moves up to n values to out, returns the number popped
+  // The cells are destroyed before head is published, a throwing move would
+  // leave them to be destroyed again
+  template <class OutputIt> std::size_t pop_n(OutputIt out, std::size_t n) {
+    static_assert(std::is_nothrow_move_assignable_v<T>,
+                  "SpscRing requires a nothrow move assignment");
+    std::size_t head = _head.load(std::memory_order_relaxed);
+    n = std::min(n, _available(head, n));
+
+    for (std::size_t i = 0; i < n; ++i, ++out) {
+      T *ptr = _cells[(head + i) & _mask].get_ptr();
+      *out = std::move(*ptr);
+      ptr->~T();
+    }
+
+    _head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  std::size_t capacity() const { return _mask + 1; }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return _head.load() == _tail.load(); }
+
+private:
+  const std::unique_ptr<Cell[]> _cells;
+  const std::size_t _mask;
+
+  // Producer cache line
+  alignas(64) std::atomic<std::size_t> _tail;
+  std::size_t _head_cache;
+
+  // Consumer cache line
+  alignas(64) std::atomic<std::size_t> _head;
+  std::size_t _tail_cache;
+
+  template <class U> bool _try_push(U &&val) {
+    std::size_t tail = _tail.load(std::memory_order_relaxed);
+    if (!_free(tail, 1))
+      return false;
+
+    new (_cells[tail & _mask].get_ptr()) T(std::forward<U>(val));
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Free cells, only reads head when the cached value doesn't leave enough
+  std::size_t _free(std::size_t tail, std::size_t wanted) {
+    std::size_t res = capacity() - (tail - _head_cache);
+    if (res < wanted) {
+      _head_cache = _head.load(std::memory_order_acquire);
+      res = capacity() - (tail - _head_cache);
+    }
+    return res;
+  }
+
+  // Full cells, only reads tail when the cached value doesn't leave enough
+  std::size_t _available(std::size_t head, std::size_t wanted) {
+    std::size_t res = _tail_cache - head;
+    if (res < wanted) {
+      _tail_cache = _tail.load(std::memory_order_acquire);
+      res = _tail_cache - head;
+    }
+    return res;
+  }
+};
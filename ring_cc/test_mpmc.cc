@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "mpmc_ring.hh"
+#include "xorshift.hh"
+
+namespace {
+
+constexpr std::size_t ITEMS_COUNT = 512 * 1024;
+constexpr std::size_t THREADS_COUNT = 16;
+constexpr std::size_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+constexpr std::size_t CAPACITY = 1024;
+
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+struct ValCounter {
+  std::atomic<int> n;
+  char offset[64]; // to avoid false sharing
+
+  ValCounter() : n(0) {}
+};
+
+std::unique_ptr<std::vector<ValCounter>> g_out;
+
+std::unique_ptr<MpmcRing<int>> g_ring;
+std::atomic<int> g_ready;
+
+void runner_produce(const int *arr) {
+  while (!g_ready)
+    continue;
+
+  for (std::size_t i = 0; i < ITEMS_PER_THREAD; ++i)
+    while (!g_ring->try_push(arr[i]))
+      continue;
+}
+
+void runner_consume() {
+  while (!g_ready)
+    continue;
+
+  for (std::size_t i = 0; i < ITEMS_PER_THREAD; ++i) {
+    int next;
+    while (!g_ring->try_pop(next))
+      continue;
+    ++((*g_out)[next].n);
+  }
+}
+
+void runner_prod_cons(const int *arr) {
+  while (!g_ready)
+    continue;
+
+  for (std::size_t i = 0; i < ITEMS_PER_THREAD; ++i) {
+    // Push
+    while (!g_ring->try_push(arr[i]))
+      continue;
+
+    // Pop
+    int next;
+    while (!g_ring->try_pop(next))
+      continue;
+    ++((*g_out)[next].n);
+  }
+}
+
+void run_test(bool duo) {
+  g_ready = false;
+  g_ring = std::make_unique<MpmcRing<int>>(CAPACITY);
+
+  std::vector<int> input(ITEMS_COUNT);
+  for (std::size_t i = 0; i < input.size(); ++i)
+    input[i] = i;
+
+  Xorshift xs(172847);
+  xs.shuffle(&input[0], input.size());
+
+  g_out = std::make_unique<std::vector<ValCounter>>(ITEMS_COUNT);
+
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i) {
+    if (duo) {
+      ths.emplace_back(runner_produce, &input[i * ITEMS_PER_THREAD]);
+      ths.emplace_back(runner_consume);
+    } else
+      ths.emplace_back(runner_prod_cons, &input[i * ITEMS_PER_THREAD]);
+  }
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(g_ring->empty());
+  for (const auto &x : *g_out)
+    REQUIRE(x.n == 1);
+}
+
+struct ThrowingCopy {
+  int val;
+
+  ThrowingCopy(int val) : val(val) {}
+  ThrowingCopy(const ThrowingCopy &other) : val(other.val) {
+    if (val < 0)
+      throw std::runtime_error{"copy"};
+  }
+  ThrowingCopy(ThrowingCopy &&other) noexcept : val(other.val) {}
+  ThrowingCopy &operator=(const ThrowingCopy &) = default;
+  ThrowingCopy &operator=(ThrowingCopy &&) noexcept = default;
+};
+
+} // namespace
+
+TEST_CASE("ring full / empty") {
+  REQUIRE_THROWS(MpmcRing<int>(12));
+
+  MpmcRing<std::string> ring(4);
+  REQUIRE(ring.capacity() == 4);
+  REQUIRE(ring.empty());
+
+  std::string val;
+  REQUIRE(!ring.try_pop(val));
+
+  for (std::size_t lap = 0; lap < 3; ++lap) {
+    for (int i = 0; i < 4; ++i)
+      REQUIRE(ring.try_push(std::to_string(i)));
+    REQUIRE(!ring.try_push("full"));
+
+    for (int i = 0; i < 4; ++i) {
+      REQUIRE(ring.try_pop(val));
+      REQUIRE(val == std::to_string(i));
+    }
+    REQUIRE(!ring.try_pop(val));
+    REQUIRE(ring.empty());
+  }
+
+  // Values still inside are destroyed with the ring
+  auto shared = std::make_shared<int>(3);
+  {
+    MpmcRing<std::shared_ptr<int>> other(2);
+    REQUIRE(other.try_push(shared));
+    REQUIRE(shared.use_count() == 2);
+  }
+  REQUIRE(shared.use_count() == 1);
+}
+
+TEST_CASE("throwing copy leaves the ring usable") {
+  MpmcRing<ThrowingCopy> ring(4);
+
+  const ThrowingCopy bad(-1);
+  const ThrowingCopy good(1);
+  REQUIRE(ring.try_push(good));
+  REQUIRE_THROWS(ring.try_push(bad));
+  REQUIRE(ring.try_push(good));
+
+  // No slot was lost to the failed push
+  ThrowingCopy val(0);
+  REQUIRE(ring.try_pop(val));
+  REQUIRE(val.val == 1);
+  REQUIRE(ring.try_pop(val));
+  REQUIRE(val.val == 1);
+  REQUIRE(!ring.try_pop(val));
+
+  for (int i = 0; i < 4; ++i)
+    REQUIRE(ring.try_push(good));
+  REQUIRE(!ring.try_push(good));
+}
+
+TEST_CASE("Test N consumer + N producer") { run_test(true); }
+
+TEST_CASE("Test N consumer / producer") { run_test(false); }
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "spsc_ring.hh"
+
+namespace {
+
+constexpr std::size_t ITEMS_COUNT = 4 * 1024 * 1024;
+constexpr std::size_t CAPACITY = 1024;
+constexpr std::size_t BATCH = 64;
+
+// Values must come out in push order
+void run_test(bool batch) {
+  SpscRing<std::size_t> ring(CAPACITY);
+
+  std::thread producer([&ring, batch] {
+    std::size_t buf[BATCH];
+    for (std::size_t i = 0; i < ITEMS_COUNT;) {
+      if (!batch) {
+        if (ring.try_push(i))
+          ++i;
+        continue;
+      }
+
+      std::size_t n = std::min(BATCH, ITEMS_COUNT - i);
+      for (std::size_t j = 0; j < n; ++j)
+        buf[j] = i + j;
+      i += ring.push_n(buf, n);
+    }
+  });
+
+  std::size_t expected = 0;
+  std::size_t buf[BATCH];
+  while (expected < ITEMS_COUNT) {
+    std::size_t n = batch ? ring.pop_n(buf, BATCH) : ring.try_pop(buf[0]);
+    for (std::size_t j = 0; j < n; ++j, ++expected)
+      REQUIRE(buf[j] == expected);
+  }
+
+  producer.join();
+  REQUIRE(ring.empty());
+}
+
+// Counts live instances, copying a negative value throws
+struct ThrowingCopy {
+  static int alive;
+  int val;
+
+  ThrowingCopy(int val) : val(val) { ++alive; }
+  ThrowingCopy(const ThrowingCopy &other) : val(other.val) {
+    if (val < 0)
+      throw std::runtime_error{"copy"};
+    ++alive;
+  }
+  ThrowingCopy &operator=(const ThrowingCopy &) = default;
+  ~ThrowingCopy() { --alive; }
+};
+
+int ThrowingCopy::alive = 0;
+
+} // namespace
+
+TEST_CASE("spsc full / empty") {
+  REQUIRE_THROWS(SpscRing<int>(0));
+
+  SpscRing<std::string> ring(4);
+  REQUIRE(ring.capacity() == 4);
+
+  std::string val;
+  REQUIRE(!ring.try_pop(val));
+
+  for (std::size_t lap = 0; lap < 3; ++lap) {
+    for (int i = 0; i < 4; ++i)
+      REQUIRE(ring.try_push(std::to_string(i)));
+    REQUIRE(!ring.try_push("full"));
+
+    for (int i = 0; i < 4; ++i) {
+      REQUIRE(ring.try_pop(val));
+      REQUIRE(val == std::to_string(i));
+    }
+    REQUIRE(!ring.try_pop(val));
+    REQUIRE(ring.empty());
+  }
+}
+
+TEST_CASE("spsc push_n / pop_n") {
+  SpscRing<std::unique_ptr<int>> ring(8);
+
+  std::vector<std::unique_ptr<int>> in;
+  for (int i = 0; i < 6; ++i)
+    in.push_back(std::make_unique<int>(i));
+
+  // Only as many as free cells
+  REQUIRE(ring.push_n(std::make_move_iterator(in.begin()), 6) == 6);
+  REQUIRE(ring.push_n(std::make_move_iterator(in.begin()), 6) == 2);
+
+  std::vector<std::unique_ptr<int>> out;
+  REQUIRE(ring.pop_n(std::back_inserter(out), 4) == 4);
+  REQUIRE(ring.pop_n(std::back_inserter(out), 10) == 4);
+  REQUIRE(ring.pop_n(std::back_inserter(out), 10) == 0);
+
+  for (int i = 0; i < 6; ++i)
+    REQUIRE(*out[i] == i);
+  // Moved-from values
+  REQUIRE(!out[6]);
+  REQUIRE(!out[7]);
+
+  // Values still inside are destroyed with the ring
+  auto shared = std::make_shared<int>(3);
+  {
+    SpscRing<std::shared_ptr<int>> other(2);
+    REQUIRE(other.try_push(shared));
+    REQUIRE(shared.use_count() == 2);
+  }
+  REQUIRE(shared.use_count() == 1);
+}
+
+TEST_CASE("spsc push_n with a throwing copy") {
+  SpscRing<ThrowingCopy> ring(8);
+  {
+    std::vector<ThrowingCopy> in;
+    in.reserve(4);
+    for (int val : {1, 2, -1, 4})
+      in.emplace_back(val);
+    REQUIRE(ThrowingCopy::alive == 4);
+
+    // The 2 values built before the throw are destroyed, none published
+    REQUIRE_THROWS(ring.push_n(in.begin(), in.size()));
+    REQUIRE(ThrowingCopy::alive == 4);
+    REQUIRE(ring.empty());
+
+    REQUIRE(ring.push_n(in.begin(), 2) == 2);
+    std::vector<ThrowingCopy> out;
+    out.reserve(2);
+    REQUIRE(ring.pop_n(std::back_inserter(out), 8) == 2);
+    REQUIRE(out[0].val == 1);
+    REQUIRE(out[1].val == 2);
+  }
+  REQUIRE(ThrowingCopy::alive == 0);
+}
+
+TEST_CASE("spsc producer / consumer") { run_test(false); }
+
+TEST_CASE("spsc producer / consumer batch") { run_test(true); }
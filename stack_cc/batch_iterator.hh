@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+// Forward iterator over a chain of nodes taken by pop_all
+// Node must provide T &value() and Node *next_node()
+template <class Node, class T> class BatchIterator {
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T *;
+  using reference = T &;
+
+  BatchIterator() : _node(nullptr) {}
+  explicit BatchIterator(Node *node) : _node(node) {}
+
+  T &operator*() const { return _node->value(); }
+  T *operator->() const { return &_node->value(); }
+
+  BatchIterator &operator++() {
+    _node = _node->next_node();
+    return *this;
+  }
+
+  BatchIterator operator++(int) {
+    BatchIterator res = *this;
+    ++*this;
+    return res;
+  }
+
+  bool operator==(const BatchIterator &it) const { return _node == it._node; }
+  bool operator!=(const BatchIterator &it) const { return _node != it._node; }
+
+private:
+  Node *_node;
+};
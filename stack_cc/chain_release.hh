@@ -0,0 +1,30 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+// Releases the owning next link of a node being destroyed (shared_ptr nodes of
+// the lock and flat_combining stacks, and of the queue_cc queues)
+//
+// Destroying the last owner of a chain destroys the next node, which releases
+// its own next link, and so on: one stack frame per node, a long chain
+// overflows the call stack. The nested calls only queue their link for the
+// outer one, which drops them in a loop. Nodes still shared are left alone, by
+// the count itself: no peeking at use_count.
+template <class Link> void release_chain(Link link) {
+  thread_local std::vector<Link> pending;
+  thread_local bool releasing = false;
+
+  if (!link)
+    return;
+  pending.push_back(std::move(link));
+  if (releasing)
+    return;
+
+  releasing = true;
+  while (!pending.empty()) {
+    Link cur = std::move(pending.back());
+    pending.pop_back();
+  }
+  releasing = false;
+}
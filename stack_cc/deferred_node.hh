@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "../epoch/epoch.hh"
+
+// Base of the nodes of the reference counted stacks (shared_ptr,
+// my_shared_ptr, intrusive), lets find walk them without touching the counts
+//
+// A node whose count drops to 0 is retired instead of freed: destroyed once no
+// epoch critical section can still read it. find reads the raw link, inside a
+// critical section, and only takes a reference on the node it returns.
+// The reference counted next link is released as soon as the count drops to 0,
+// the raw link stays valid until the node is freed.
+//
+// Keeps a copy of the allocator of the node (empty base: nothing for stateless
+// allocators), used to free it
+// Node::next is the reference counted next link
+template <class Node, class Alloc>
+class DeferredNode : private std::allocator_traits<
+                         Alloc>::template rebind_alloc<Node> {
+
+  using NodeAlloc =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+  using Traits = std::allocator_traits<NodeAlloc>;
+
+public:
+  // Copy of the next link, only read by find
+  Node *link;
+
+  explicit DeferredNode(const Alloc &alloc) : NodeAlloc(alloc), link(nullptr) {}
+
+  // Node is constructed with a copy of the allocator first
+  template <class... Args>
+  static Node *create(const Alloc &alloc, Args &&... args) {
+    NodeAlloc node_alloc(alloc);
+    Node *res = Traits::allocate(node_alloc, 1);
+    try {
+      ::new (static_cast<void *>(res)) Node(alloc, std::forward<Args>(args)...);
+    } catch (...) {
+      Traits::deallocate(node_alloc, res, 1);
+      throw;
+    }
+    return res;
+  }
+
+  // Count dropped to 0: retires the node and releases its next link
+  // Releasing a link may release a long chain, the nested calls only queue the
+  // nodes for the outer one (no recursion, no peeking at the counts)
+  static void release(Node *node) {
+    thread_local std::vector<Node *> pending;
+    thread_local bool releasing = false;
+
+    pending.push_back(node);
+    if (releasing)
+      return;
+
+    releasing = true;
+    while (!pending.empty()) {
+      Node *cur = pending.back();
+      pending.pop_back();
+
+      auto next = std::move(cur->next);
+      retire(cur);
+    }
+    releasing = false;
+  }
+
+  // Destroyed once no find can read it anymore
+  // In the scope of a FreeNow, destroyed right away
+  static void retire(Node *node) {
+    if (_free_now())
+      _destroy(node);
+    else
+      epoch_retire(node, &DeferredNode::_destroy);
+  }
+
+  // For the destruction of the stack: no find can run anymore, and the epoch
+  // domain may already be destroyed (static stacks)
+  class FreeNow {
+  public:
+    FreeNow() { ++_free_now(); }
+    ~FreeNow() { --_free_now(); }
+
+    FreeNow(const FreeNow &) = delete;
+    FreeNow &operator=(const FreeNow &) = delete;
+  };
+
+private:
+  static std::size_t &_free_now() {
+    thread_local std::size_t res = 0;
+    return res;
+  }
+
+  static void _destroy(void *ptr) {
+    Node *node = static_cast<Node *>(ptr);
+    DeferredNode &base = *node;
+    NodeAlloc alloc(std::move(static_cast<NodeAlloc &>(base)));
+    node->~Node();
+    Traits::deallocate(alloc, node, 1);
+  }
+};
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "../../epoch/epoch.hh"
+#include "../../utils/xorshift.hh"
+#include "../batch_iterator.hh"
+#include "../node_allocator.hh"
+#include "../stack_stats.hh"
+#include "../stack_wait.hh"
+
+// Elimination-backoff stack (Hendler, Shavit, Yerushalmi, 2004)
+//
+// Treiber stack with raw nodes, protected by epoch-based reclamation, with the
+// same handles as the epoch stack (a reference in the node, no section kept).
+// When a CAS on the head fails, instead of retrying right away, the thread
+// backs off to a random slot of an elimination array:
+// - push offers its node in an empty slot, and waits for a pop to take it
+// - pop takes any node offered in a slot
+// A push and a pop that meet in the array cancel out without touching the
+// head.
+// The range of slots used adapts to contention: it grows when a push finds
+// its slot busy, and shrinks when a thread waited for nobody.
+template <class T, class Alloc = std::allocator<T>>
+class Stack : public StackCounters, public StackWait<Stack<T, Alloc>> {
+
+  struct Node {
+    T val;
+    Node *next;
+    // 1 for the stack (dropped once retired) + 1 per push / find handle
+    std::atomic<unsigned> refs;
+
+    template <class... Args>
+    Node(Args &&... args)
+        : val(std::forward<Args>(args)...), next(nullptr), refs(1) {}
+
+    T &value() { return val; }
+    Node *next_node() const { return next; }
+  };
+
+  using NodeAlloc = NodeAllocator<Node, Alloc>;
+
+  struct alignas(64) Slot {
+    std::atomic<Node *> node;
+
+    Slot() : node(nullptr) {}
+  };
+
+  static constexpr std::size_t MAX_WIDTH = 32;
+  static constexpr std::size_t SPIN_COUNT = 128;
+
+public:
+  // Handle to a value of the stack
+  // Owns the node after a pop (retired on destruction), otherwise holds a
+  // reference on it: never keeps a critical section, can be destroyed by any
+  // thread
+  class ref_t {
+  public:
+    ref_t() : _node(nullptr), _owner(false) {}
+
+    ref_t(ref_t &&r) : _node(r._node), _owner(r._owner) {
+      r._node = nullptr;
+      r._owner = false;
+    }
+
+    ref_t &operator=(ref_t &&r) {
+      ref_t{std::move(r)}.swap(*this);
+      return *this;
+    }
+
+    ref_t(const ref_t &) = delete;
+    ref_t &operator=(const ref_t &) = delete;
+
+    ~ref_t() {
+      if (!_node)
+        return;
+      if (_owner)
+        epoch_retire(_node, &Stack::_unref_void);
+      else
+        Stack::_unref(_node);
+    }
+
+    void swap(ref_t &r) {
+      std::swap(_node, r._node);
+      std::swap(_owner, r._owner);
+    }
+
+    T *get() const { return _node ? &_node->val : nullptr; }
+    T &operator*() const { return *get(); }
+    T *operator->() const { return get(); }
+
+    operator bool() const { return _node != nullptr; }
+
+  private:
+    Node *_node;
+    bool _owner;
+
+    ref_t(Node *node, bool owner) : _node(node), _owner(owner) {}
+
+    friend class Stack;
+  };
+
+  // Chain of nodes taken by pop_all, top of the stack first
+  // The whole chain is retired at once on destruction, nodes still held by a
+  // handle are left to it
+  class batch_t {
+  public:
+    using iterator = BatchIterator<Node, T>;
+
+    batch_t() : _head(nullptr) {}
+
+    batch_t(batch_t &&b) : _head(b._head) { b._head = nullptr; }
+
+    batch_t &operator=(batch_t &&b) {
+      batch_t{std::move(b)}.swap(*this);
+      return *this;
+    }
+
+    batch_t(const batch_t &) = delete;
+    batch_t &operator=(const batch_t &) = delete;
+
+    ~batch_t() {
+      if (_head)
+        epoch_retire(_head, &Stack::_unref_chain);
+    }
+
+    void swap(batch_t &b) { std::swap(_head, b._head); }
+
+    iterator begin() const { return iterator(_head); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return !_head; }
+
+  private:
+    Node *_head;
+
+    batch_t(Node *head) : _head(head) {}
+
+    friend class Stack;
+  };
+
+  Stack() : _head(nullptr), _width(1) {}
+
+  Stack(const Stack &) = delete;
+  Stack &operator=(const Stack &) = delete;
+
+  ~Stack() { _unref_chain(_head.load(std::memory_order_acquire)); }
+
+  ref_t push(const T &val) { return emplace(val); }
+
+  ref_t push(T &&val) { return emplace(std::move(val)); }
+
+  // Constructs the value in place, inside the node
+  // The handle reference is taken before the node is reachable: no RMW
+  template <class... Args> ref_t emplace(Args &&... args) {
+    _count_op();
+    Node *node = NodeAlloc::create(std::forward<Args>(args)...);
+    node->refs.store(2, std::memory_order_relaxed);
+
+    node->next = _head.load(std::memory_order_relaxed);
+    while (!_head.compare_exchange_weak(node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+      _count_cas_retry();
+      if (_eliminate_push(node))
+        break;
+    }
+    this->_notify_push();
+
+    return ref_t(node, false);
+  }
+
+  // Same as pushing the values one by one, the chain is built privately then
+  // spliced with a single CAS
+  // No elimination: a pop can only take a single node
+  template <class InputIt> void push_range(InputIt first, InputIt last) {
+    _count_op();
+    if (first == last)
+      return;
+
+    Node *chain = NodeAlloc::create(*first);
+    Node *chain_last = chain;
+    for (++first; first != last; ++first) {
+      Node *node = NodeAlloc::create(*first);
+      node->next = chain;
+      chain = node;
+    }
+
+    chain_last->next = _head.load(std::memory_order_relaxed);
+    while (!_head.compare_exchange_weak(chain_last->next, chain,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+      _count_cas_retry();
+    this->_notify_push_range();
+  }
+
+  ref_t try_pop() {
+    _count_op();
+    EpochGuard guard;
+
+    Node *node = _head.load(std::memory_order_acquire);
+    for (;;) {
+      // Empty, but a push may be waiting in the array
+      // A node taken there was never in the stack, no CAS on the head
+      if (!node) {
+        node = _eliminate_pop(1);
+        break;
+      }
+
+      if (_head.compare_exchange_weak(node, node->next,
+                                      std::memory_order_acquire,
+                                      std::memory_order_acquire))
+        break;
+      _count_cas_retry();
+
+      Node *other = _eliminate_pop(SPIN_COUNT);
+      if (other) {
+        node = other;
+        break;
+      }
+      node = _head.load(std::memory_order_acquire);
+    }
+
+    if (!node)
+      _count_empty_pop();
+    return ref_t(node, node != nullptr);
+  }
+
+  batch_t pop_all() {
+    _count_op();
+    return batch_t(_head.exchange(nullptr, std::memory_order_acquire));
+  }
+
+  // The reference is taken inside the section: the stack still holds its own
+  ref_t find(const T &val) {
+    _count_op();
+    EpochGuard guard;
+
+    Node *node = _head.load(std::memory_order_acquire);
+    std::size_t steps = 0;
+    for (; node && !(node->val == val); ++steps)
+      node = node->next;
+    _count_find(steps);
+
+    if (node)
+      node->refs.fetch_add(1, std::memory_order_relaxed);
+    return ref_t(node, false);
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return !_head.load(); }
+
+private:
+  std::atomic<Node *> _head;
+
+  // Once the stack reference is dropped, no reader can see the node, nobody
+  // can take a new reference: a single one left needs no RMW
+  static void _unref(Node *node) {
+    if (node->refs.load(std::memory_order_acquire) == 1 ||
+        node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      NodeAlloc::destroy(node);
+  }
+
+  // Drops the stack reference of a retired node
+  static void _unref_void(void *ptr) { _unref(static_cast<Node *>(ptr)); }
+
+  // Drops the stack reference of every node of a chain
+  static void _unref_chain(void *ptr) {
+    Node *node = static_cast<Node *>(ptr);
+    while (node) {
+      Node *next = node->next;
+      _unref(node);
+      node = next;
+    }
+  }
+
+protected:
+  // Elimination array, tests can offer a node without a racing push
+  Slot _slots[MAX_WIDTH];
+  std::atomic<std::size_t> _width;
+
+  static Xorshift &_rng() {
+    thread_local Xorshift res(
+        std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1);
+    return res;
+  }
+
+  Slot &_pick_slot() {
+    return _slots[_rng().next(_width.load(std::memory_order_relaxed))];
+  }
+
+  // Only a hint, races between updates don't matter
+  void _grow() {
+    std::size_t width = _width.load(std::memory_order_relaxed);
+    if (width < MAX_WIDTH)
+      _width.store(width * 2, std::memory_order_relaxed);
+  }
+
+  void _shrink() {
+    std::size_t width = _width.load(std::memory_order_relaxed);
+    if (width > 1)
+      _width.store(width / 2, std::memory_order_relaxed);
+  }
+
+  // Returns true if the node was taken by a pop
+  bool _eliminate_push(Node *node) {
+    Slot &slot = _pick_slot();
+
+    Node *empty = nullptr;
+    if (!slot.node.compare_exchange_strong(empty, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+      _grow();
+      return false;
+    }
+
+    for (std::size_t i = 0; i < SPIN_COUNT; ++i)
+      if (slot.node.load(std::memory_order_relaxed) != node)
+        return true;
+
+    // Withdraw the offer, fails if a pop took it in between
+    Node *offered = node;
+    if (slot.node.compare_exchange_strong(offered, nullptr,
+                                          std::memory_order_relaxed)) {
+      _shrink();
+      return false;
+    }
+    return true;
+  }
+
+  Node *_eliminate_pop(std::size_t spin_count) {
+    Slot &slot = _pick_slot();
+
+    for (std::size_t i = 0; i < spin_count; ++i) {
+      Node *node = slot.node.load(std::memory_order_relaxed);
+      if (node && slot.node.compare_exchange_strong(node, nullptr,
+                                                    std::memory_order_acquire,
+                                                    std::memory_order_relaxed))
+        return node;
+    }
+
+    _shrink();
+    return nullptr;
+  }
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#ifdef __linux__
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Event count: lets threads wait for a condition checked without a lock
+//
+// A waiter announces itself and reads the epoch (prepare_wait), checks its
+// condition again, then sleeps until the epoch changes (wait). A notifier
+// makes the condition true, then bumps the epoch and wakes the sleepers, only
+// if someone announced itself: notifying nobody is a fence and a load.
+// Parks on a futex on the epoch word on Linux, on a condition variable
+// elsewhere.
+class EventCount {
+public:
+  using Key = std::uint32_t;
+
+  EventCount() : _epoch(0), _waiters(0) {}
+
+  EventCount(const EventCount &) = delete;
+  EventCount &operator=(const EventCount &) = delete;
+
+  // Then check the condition, and call either cancel_wait or wait
+  Key prepare_wait() {
+    _waiters.fetch_add(1, std::memory_order_seq_cst);
+    return _epoch.load(std::memory_order_seq_cst);
+  }
+
+  void cancel_wait() { _waiters.fetch_sub(1, std::memory_order_relaxed); }
+
+  void wait(Key key) {
+    while (_epoch.load(std::memory_order_acquire) == key)
+      _park(key, nullptr);
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // False if the deadline was reached first
+  template <class Clock, class Duration>
+  bool wait_until(Key key,
+                  const std::chrono::time_point<Clock, Duration> &deadline) {
+    bool res = true;
+    while (_epoch.load(std::memory_order_acquire) == key) {
+      auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          deadline - Clock::now());
+      if (left <= left.zero()) {
+        res = false;
+        break;
+      }
+      _park(key, &left);
+    }
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+    return res;
+  }
+
+  void notify_one() { _notify(1); }
+
+  void notify_all() { _notify(INT_MAX); }
+
+private:
+  // Futex word
+  std::atomic<Key> _epoch;
+  std::atomic<std::uint32_t> _waiters;
+
+  static_assert(sizeof(std::atomic<Key>) == sizeof(Key), "");
+
+#ifndef __linux__
+  std::mutex _mut;
+  std::condition_variable _cv;
+#endif
+
+  void _notify(int count) {
+    // Orders the condition change before the load: either the waiter sees the
+    // condition, or we see the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!_waiters.load(std::memory_order_relaxed))
+      return;
+
+    _epoch.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+    syscall(SYS_futex, &_epoch, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr,
+            0);
+#else
+    { std::lock_guard<std::mutex> lock(_mut); }
+    if (count == 1)
+      _cv.notify_one();
+    else
+      _cv.notify_all();
+#endif
+  }
+
+  // Sleeps if the epoch is still key, at most left if not null
+  // May return early (spurious wake-up)
+  void _park(Key key, const std::chrono::nanoseconds *left) {
+#ifdef __linux__
+    struct timespec ts;
+    if (left) {
+      ts.tv_sec = left->count() / 1000000000;
+      ts.tv_nsec = left->count() % 1000000000;
+    }
+    syscall(SYS_futex, &_epoch, FUTEX_WAIT_PRIVATE, key, left ? &ts : nullptr,
+            nullptr, 0);
+#else
+    std::unique_lock<std::mutex> lock(_mut);
+    auto changed = [&] {
+      return _epoch.load(std::memory_order_acquire) != key;
+    };
+    if (left)
+      _cv.wait_for(lock, *left, changed);
+    else
+      _cv.wait(lock, changed);
+#endif
+  }
+};
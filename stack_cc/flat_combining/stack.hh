@@ -0,0 +1,266 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "../../my_shared_ptr/spinlock.hh"
+#include "../batch_iterator.hh"
+#include "../chain_release.hh"
+#include "../stack_stats.hh"
+#include "../stack_wait.hh"
+#include "../thread_index.hh"
+
+// Flat combining stack (Hendler, Incze, Shavit, Tzafrir, 2010)
+//
+// Sequential stack of shared_ptr nodes, as lock/stack.hh, behind a combiner
+// lock. push / try_pop publish their request in the record of their thread,
+// then either get the lock, or spin on their own record until served: the
+// lock holder (the combiner) applies all the published requests in one pass,
+// and the head stays in its cache.
+// In a pass, pending pops take the nodes of pending pushes first: each pair
+// cancels out without touching the head.
+// Threads without a record (above ThreadIndex::MAX) and the other operations
+// take the lock and work on the stack directly.
+template <class T, class Alloc = std::allocator<T>>
+class Stack : public StackCounters, public StackWait<Stack<T, Alloc>> {
+
+  struct Node {
+    T val;
+    std::shared_ptr<Node> next;
+
+    template <class... Args>
+    Node(Args &&... args) : val(std::forward<Args>(args)...) {}
+
+    ~Node() { release_chain(std::move(next)); }
+
+    T &value() { return val; }
+    Node *next_node() const { return next.get(); }
+  };
+
+  enum Op { NONE, PUSH, POP };
+
+  // node is written by the thread of the record while op is NONE, by the
+  // combiner otherwise
+  struct alignas(64) Record {
+    std::atomic<Op> op;
+    std::shared_ptr<Node> node; // pushed node, then popped node once served
+
+    Record() : op(NONE) {}
+  };
+
+public:
+  using ref_t = std::shared_ptr<T>;
+
+  // Chain of nodes taken by pop_all, top of the stack first
+  class batch_t {
+  public:
+    using iterator = BatchIterator<Node, T>;
+
+    batch_t() = default;
+
+    batch_t(batch_t &&b) : _head(std::move(b._head)) {}
+
+    batch_t &operator=(batch_t &&b) {
+      batch_t{std::move(b)}.swap(*this);
+      return *this;
+    }
+
+    void swap(batch_t &b) { _head.swap(b._head); }
+
+    iterator begin() const { return iterator(_head.get()); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return !_head; }
+
+  private:
+    std::shared_ptr<Node> _head;
+
+    batch_t(std::shared_ptr<Node> head) : _head(std::move(head)) {}
+
+    friend class Stack;
+  };
+
+  Stack() : _nb_records(0) {}
+
+  // Nodes are allocated through a copy of alloc, rebound to the node type
+  explicit Stack(const Alloc &alloc) : _alloc(alloc), _nb_records(0) {}
+
+  Stack(const Stack &) = delete;
+  Stack &operator=(const Stack &) = delete;
+
+  std::shared_ptr<T> push(const T &val) { return emplace(val); }
+
+  std::shared_ptr<T> push(T &&val) { return emplace(std::move(val)); }
+
+  // Constructs the value in place, inside the node
+  // The node is allocated before publishing the request
+  template <class... Args> std::shared_ptr<T> emplace(Args &&... args) {
+    _count_op();
+    auto node = std::allocate_shared<Node>(_alloc, std::forward<Args>(args)...);
+    std::shared_ptr<T> res(node, &node->val);
+
+    _apply(PUSH, std::move(node));
+    this->_notify_push();
+    return res;
+  }
+
+  // Same as pushing the values one by one, in a single critical section
+  template <class InputIt> void push_range(InputIt first, InputIt last) {
+    _count_op();
+    if (first == last)
+      return;
+
+    auto chain = std::allocate_shared<Node>(_alloc, *first);
+    Node *chain_last = chain.get();
+    for (++first; first != last; ++first) {
+      auto node = std::allocate_shared<Node>(_alloc, *first);
+      node->next = std::move(chain);
+      chain = std::move(node);
+    }
+
+    {
+      std::lock_guard<TtasLock> lock(_lock);
+      chain_last->next = std::move(_head);
+      _head = std::move(chain);
+    }
+    this->_notify_push_range();
+  }
+
+  std::shared_ptr<T> try_pop() {
+    _count_op();
+    auto node = _apply(POP, nullptr);
+    if (!node) {
+      _count_empty_pop();
+      return nullptr;
+    }
+    return std::shared_ptr<T>(node, &node->val);
+  }
+
+  batch_t pop_all() {
+    _count_op();
+    std::lock_guard<TtasLock> lock(_lock);
+    return batch_t(std::move(_head));
+  }
+
+  std::shared_ptr<T> find(const T &val) {
+    _count_op();
+    std::lock_guard<TtasLock> lock(_lock);
+
+    // The nodes can't be released under the lock, only the one found is
+    // referenced
+    const std::shared_ptr<Node> *node = &_head;
+    std::size_t steps = 0;
+    for (; *node && !((*node)->val == val); ++steps)
+      node = &(*node)->next;
+    _count_find(steps);
+
+    if (!*node)
+      return nullptr;
+    return std::shared_ptr<T>(*node, &(*node)->val);
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const {
+    std::lock_guard<TtasLock> lock(_lock);
+    return !_head;
+  }
+
+private:
+  Alloc _alloc;
+  mutable TtasLock _lock;
+  std::shared_ptr<Node> _head;
+
+  // Records of the threads, indexed by ThreadIndex
+  // A pass only scans the first _nb_records, up to the highest index seen
+  std::atomic<std::size_t> _nb_records;
+  Record _records[ThreadIndex::MAX];
+
+  // Returns the popped node for a POP
+  std::shared_ptr<Node> _apply(Op op, std::shared_ptr<Node> node) {
+    std::size_t index = ThreadIndex::get();
+    if (index == ThreadIndex::MAX) {
+      std::lock_guard<TtasLock> lock(_lock);
+      if (op == PUSH)
+        _push_head(std::move(node));
+      else
+        node = _pop_head();
+      _combine();
+      return node;
+    }
+
+    // A combiner missing the new count only leaves the request to the next
+    // pass, the thread keeps trying to combine until served
+    std::size_t nb = _nb_records.load(std::memory_order_relaxed);
+    while (nb <= index &&
+           !_nb_records.compare_exchange_weak(nb, index + 1,
+                                              std::memory_order_relaxed))
+      continue;
+
+    Record &rec = _records[index];
+    rec.node = std::move(node);
+    rec.op.store(op, std::memory_order_release);
+
+    SpinWait spin;
+    while (rec.op.load(std::memory_order_acquire) != NONE) {
+      if (_lock.try_lock()) {
+        _combine();
+        _lock.unlock();
+      } else
+        spin.wait();
+    }
+    return std::move(rec.node);
+  }
+
+  // Must hold _lock
+  void _combine() {
+    Record *pushes[ThreadIndex::MAX];
+    Record *pops[ThreadIndex::MAX];
+    std::size_t nb_pushes = 0;
+    std::size_t nb_pops = 0;
+
+    std::size_t nb = _nb_records.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < nb; ++i) {
+      Op op = _records[i].op.load(std::memory_order_acquire);
+      if (op == PUSH)
+        pushes[nb_pushes++] = &_records[i];
+      else if (op == POP)
+        pops[nb_pops++] = &_records[i];
+    }
+
+    // Each push followed by a pop
+    for (; nb_pushes && nb_pops; --nb_pushes, --nb_pops) {
+      Record &push = *pushes[nb_pushes - 1];
+      Record &pop = *pops[nb_pops - 1];
+      pop.node = std::move(push.node);
+      push.op.store(NONE, std::memory_order_release);
+      pop.op.store(NONE, std::memory_order_release);
+    }
+
+    for (std::size_t i = 0; i < nb_pushes; ++i) {
+      _push_head(std::move(pushes[i]->node));
+      pushes[i]->op.store(NONE, std::memory_order_release);
+    }
+    for (std::size_t i = 0; i < nb_pops; ++i) {
+      pops[i]->node = _pop_head();
+      pops[i]->op.store(NONE, std::memory_order_release);
+    }
+  }
+
+  // Must hold _lock
+  void _push_head(std::shared_ptr<Node> node) {
+    node->next = std::move(_head);
+    _head = std::move(node);
+  }
+
+  // Must hold _lock
+  std::shared_ptr<Node> _pop_head() {
+    auto res = std::move(_head);
+    if (res)
+      _head = std::move(res->next);
+    return res;
+  }
+};
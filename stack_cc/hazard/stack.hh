@@ -0,0 +1,365 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "../../hazard_ptr/hazard_pointer.hh"
+#include "../batch_iterator.hh"
+#include "../node_allocator.hh"
+#include "../stack_stats.hh"
+#include "../stack_wait.hh"
+
+// Treiber stack with raw nodes, protected by hazard pointers
+//
+// Pop is done in 2 steps:
+// - mark the head (logical removal, the thread that marks owns the node)
+// - set the popped flag of the node, and move the head to the next node
+// Any thread seeing a marked head helps finishing the pop, and push can't
+// succeed on a marked head.
+// That guarantees the popped flag of a node is set before the next node can be
+// popped, which allows find to validate its traversal: once the next node is
+// protected, it's safe to use as long as the current node isn't popped.
+// pop_all takes the whole chain at once: it sets the popped flag of all its
+// nodes before retiring any of them.
+template <class T, class Alloc = std::allocator<T>>
+class Stack : public StackCounters, public StackWait<Stack<T, Alloc>> {
+
+  struct Node {
+    T val;
+    Node *next;
+    std::atomic<bool> popped;
+
+    template <class... Args>
+    Node(Args &&... args)
+        : val(std::forward<Args>(args)...), next(nullptr), popped(false) {}
+
+    T &value() { return val; }
+    Node *next_node() const { return next; }
+  };
+
+  using NodeAlloc = NodeAllocator<Node, Alloc>;
+
+  static constexpr std::uintptr_t MARK = 1;
+
+public:
+  // Handle to a value of the stack
+  // Owns the node after a pop (retired on destruction), otherwise protects it
+  // with a hazard pointer
+  class ref_t {
+  public:
+    ref_t() : _node(nullptr), _owner(false) {}
+
+    ref_t(ref_t &&r)
+        : _node(r._node), _hp(std::move(r._hp)), _owner(r._owner) {
+      r._node = nullptr;
+      r._owner = false;
+    }
+
+    ref_t &operator=(ref_t &&r) {
+      ref_t{std::move(r)}.swap(*this);
+      return *this;
+    }
+
+    ref_t(const ref_t &) = delete;
+    ref_t &operator=(const ref_t &) = delete;
+
+    ~ref_t() {
+      if (_owner)
+        hazard_retire(_node, &NodeAlloc::destroy_void);
+    }
+
+    void swap(ref_t &r) {
+      std::swap(_node, r._node);
+      _hp.swap(r._hp);
+      std::swap(_owner, r._owner);
+    }
+
+    T *get() const { return _node ? &_node->val : nullptr; }
+    T &operator*() const { return *get(); }
+    T *operator->() const { return get(); }
+
+    operator bool() const { return _node != nullptr; }
+
+  private:
+    Node *_node;
+    HazardPointer _hp;
+    bool _owner;
+
+    ref_t(Node *node) : _node(node), _owner(true) {}
+
+    ref_t(Node *node, HazardPointer &&hp)
+        : _node(node), _hp(std::move(hp)), _owner(false) {}
+
+    friend class Stack;
+  };
+
+  // Chain of nodes taken by pop_all, top of the stack first
+  // Nodes are retired on destruction
+  class batch_t {
+  public:
+    using iterator = BatchIterator<Node, T>;
+
+    batch_t() : _head(nullptr) {}
+
+    batch_t(batch_t &&b) : _head(b._head) { b._head = nullptr; }
+
+    batch_t &operator=(batch_t &&b) {
+      batch_t{std::move(b)}.swap(*this);
+      return *this;
+    }
+
+    batch_t(const batch_t &) = delete;
+    batch_t &operator=(const batch_t &) = delete;
+
+    ~batch_t() {
+      Node *node = _head;
+      while (node) {
+        Node *next = node->next;
+        hazard_retire(node, &NodeAlloc::destroy_void);
+        node = next;
+      }
+    }
+
+    void swap(batch_t &b) { std::swap(_head, b._head); }
+
+    iterator begin() const { return iterator(_head); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return !_head; }
+
+  private:
+    Node *_head;
+
+    batch_t(Node *head) : _head(head) {}
+
+    friend class Stack;
+  };
+
+  Stack() : _head(0) {}
+
+  Stack(const Stack &) = delete;
+  Stack &operator=(const Stack &) = delete;
+
+  // Handles may outlive the stack: nodes are retired, the ones still protected
+  // by a handle are freed once it's gone
+  ~Stack() {
+    Node *node = _get_node(_head.load(std::memory_order_acquire));
+    while (node) {
+      Node *next = node->next;
+      hazard_retire(node, &NodeAlloc::destroy_void);
+      node = next;
+    }
+  }
+
+  ref_t push(const T &val) { return emplace(val); }
+
+  ref_t push(T &&val) { return emplace(std::move(val)); }
+
+  // Constructs the value in place, inside the node
+  template <class... Args> ref_t emplace(Args &&... args) {
+    _count_op();
+    Node *node = NodeAlloc::create(std::forward<Args>(args)...);
+
+    // Not reachable yet, can't be retired before the protection is visible
+    HazardPointer hp = make_hazard_pointer();
+    hp.reset_protection(node);
+
+    std::uintptr_t head = _head.load(std::memory_order_relaxed);
+    for (;;) {
+      if (head & MARK) {
+        HazardPointer help_hp = make_hazard_pointer();
+        _help_pop(head, help_hp);
+        head = _head.load(std::memory_order_relaxed);
+        continue;
+      }
+
+      node->next = _get_node(head);
+      if (_head.compare_exchange_weak(head, _to_word(node),
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed))
+        break;
+      _count_cas_retry();
+    }
+    this->_notify_push();
+
+    return ref_t(node, std::move(hp));
+  }
+
+  // Same as pushing the values one by one, the chain is built privately then
+  // spliced with a single CAS
+  template <class InputIt> void push_range(InputIt first, InputIt last) {
+    _count_op();
+    if (first == last)
+      return;
+
+    Node *chain = NodeAlloc::create(*first);
+    Node *chain_last = chain;
+    for (++first; first != last; ++first) {
+      Node *node = NodeAlloc::create(*first);
+      node->next = chain;
+      chain = node;
+    }
+
+    std::uintptr_t head = _head.load(std::memory_order_relaxed);
+    for (;;) {
+      if (head & MARK) {
+        HazardPointer help_hp = make_hazard_pointer();
+        _help_pop(head, help_hp);
+        head = _head.load(std::memory_order_relaxed);
+        continue;
+      }
+
+      chain_last->next = _get_node(head);
+      if (_head.compare_exchange_weak(head, _to_word(chain),
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed))
+        break;
+      _count_cas_retry();
+    }
+    this->_notify_push_range();
+  }
+
+  ref_t try_pop() {
+    _count_op();
+    HazardPointer hp = make_hazard_pointer();
+    std::uintptr_t head = _head.load(std::memory_order_acquire);
+
+    for (;;) {
+      Node *node = _get_node(head);
+      if (!node) {
+        _count_empty_pop();
+        return ref_t{};
+      }
+
+      if (head & MARK) {
+        _help_pop(head, hp);
+        head = _head.load(std::memory_order_acquire);
+        continue;
+      }
+
+      hp.reset_protection(node);
+      std::uintptr_t cur = _head.load(std::memory_order_seq_cst);
+      if (cur != head) {
+        head = cur;
+        continue;
+      }
+
+      if (_head.compare_exchange_weak(head, head | MARK,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        _finish_pop(head | MARK, node);
+        return ref_t(node);
+      }
+      _count_cas_retry();
+    }
+  }
+
+  batch_t pop_all() {
+    _count_op();
+    std::uintptr_t head = _head.load(std::memory_order_acquire);
+
+    for (;;) {
+      if (!_get_node(head))
+        return batch_t{};
+
+      // A pending pop must finish first, the chain would include its node
+      if (head & MARK) {
+        HazardPointer help_hp = make_hazard_pointer();
+        _help_pop(head, help_hp);
+        head = _head.load(std::memory_order_acquire);
+        continue;
+      }
+
+      if (_head.compare_exchange_weak(head, 0, std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+        break;
+      _count_cas_retry();
+    }
+
+    // A find may be anywhere in the chain, it relies on the popped flag of
+    // its current node to validate the next one
+    Node *chain = _get_node(head);
+    for (Node *node = chain; node; node = node->next)
+      node->popped.store(true, std::memory_order_seq_cst);
+    return batch_t(chain);
+  }
+
+  ref_t find(const T &val) {
+    _count_op();
+    HazardPointer hp = make_hazard_pointer();
+    HazardPointer hp_next = make_hazard_pointer();
+    std::size_t steps = 0;
+
+  restart:
+    std::uintptr_t head = _head.load(std::memory_order_acquire);
+    Node *node = _get_node(head);
+    if (!node) {
+      _count_find(steps);
+      return ref_t{};
+    }
+
+    if (head & MARK) {
+      _help_pop(head, hp);
+      goto restart;
+    }
+
+    hp.reset_protection(node);
+    if (_get_node(_head.load(std::memory_order_seq_cst)) != node)
+      goto restart;
+
+    for (;; ++steps) {
+      if (node->val == val) {
+        _count_find(steps);
+        return ref_t(node, std::move(hp));
+      }
+
+      Node *next = node->next;
+      if (!next) {
+        _count_find(steps + 1);
+        return ref_t{};
+      }
+
+      // Next protected before node is popped, so before next can be removed
+      hp_next.reset_protection(next);
+      if (node->popped.load(std::memory_order_seq_cst))
+        goto restart;
+
+      node = next;
+      hp.swap(hp_next);
+    }
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return !_get_node(_head.load()); }
+
+private:
+  std::atomic<std::uintptr_t> _head;
+
+  static Node *_get_node(std::uintptr_t word) {
+    return reinterpret_cast<Node *>(word & ~MARK);
+  }
+
+  static std::uintptr_t _to_word(Node *node) {
+    return reinterpret_cast<std::uintptr_t>(node);
+  }
+
+  void _help_pop(std::uintptr_t head, HazardPointer &hp) {
+    Node *node = _get_node(head);
+    hp.reset_protection(node);
+    if (_head.load(std::memory_order_seq_cst) != head)
+      return;
+
+    _finish_pop(head, node);
+  }
+
+  // The popped flag must be set before the head moves to the next node
+  void _finish_pop(std::uintptr_t head, Node *node) {
+    node->popped.store(true, std::memory_order_seq_cst);
+    _head.compare_exchange_strong(head, _to_word(node->next),
+                                  std::memory_order_acq_rel,
+                                  std::memory_order_relaxed);
+  }
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "../../my_shared_ptr/my_atomic_intrusive_ptr.hh"
+#include "../batch_iterator.hh"
+#include "../deferred_node.hh"
+#include "../stack_stats.hh"
+#include "../stack_wait.hh"
+
+// Same algorithm as the my_shared_ptr stack, with the reference count embedded
+// in the nodes: no control block, and handles / next links are a single word
+template <class T, class Alloc = std::allocator<T>>
+class Stack : public StackCounters, public StackWait<Stack<T, Alloc>> {
+
+  struct Node : my_intrusive_base<Node>, DeferredNode<Node, Alloc> {
+    T val;
+    my_intrusive_ptr<Node> next;
+
+    template <class... Args>
+    Node(const Alloc &alloc, Args &&... args)
+        : DeferredNode<Node, Alloc>(alloc), val(std::forward<Args>(args)...) {}
+
+    T &value() { return val; }
+    Node *next_node() const { return next.get(); }
+
+    static void intrusive_destroy(Node *node) {
+      DeferredNode<Node, Alloc>::release(node);
+    }
+  };
+
+  using Deferred = DeferredNode<Node, Alloc>;
+
+public:
+  // Handle to a value of the stack, keeps its node alive
+  class ref_t {
+  public:
+    ref_t() = default;
+
+    T *get() const { return _node ? &_node->val : nullptr; }
+    T &operator*() const { return *get(); }
+    T *operator->() const { return get(); }
+
+    operator bool() const { return _node; }
+
+  private:
+    my_intrusive_ptr<Node> _node;
+
+    ref_t(my_intrusive_ptr<Node> node) : _node(std::move(node)) {}
+
+    friend class Stack;
+  };
+
+  // Chain of nodes taken by pop_all, top of the stack first
+  class batch_t {
+  public:
+    using iterator = BatchIterator<Node, T>;
+
+    batch_t() = default;
+
+    batch_t(batch_t &&b) : _head(std::move(b._head)) {}
+
+    batch_t &operator=(batch_t &&b) {
+      batch_t{std::move(b)}.swap(*this);
+      return *this;
+    }
+
+    void swap(batch_t &b) { _head.swap(b._head); }
+
+    iterator begin() const { return iterator(_head.get()); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return !_head; }
+
+  private:
+    my_intrusive_ptr<Node> _head;
+
+    batch_t(my_intrusive_ptr<Node> head) : _head(std::move(head)) {}
+
+    friend class Stack;
+  };
+
+  Stack() = default;
+
+  // Nodes are allocated through a copy of alloc, rebound to the node type
+  explicit Stack(const Alloc &alloc) : _alloc(alloc) {}
+
+  Stack(const Stack &) = delete;
+  Stack &operator=(const Stack &) = delete;
+
+  ~Stack() {
+    typename Deferred::FreeNow free_now;
+    _head.exchange(nullptr);
+  }
+
+  ref_t push(const T &val) { return emplace(val); }
+
+  ref_t push(T &&val) { return emplace(std::move(val)); }
+
+  // Constructs the value in place, inside the node
+  template <class... Args> ref_t emplace(Args &&... args) {
+    _count_op();
+    auto new_head = _make_node(std::forward<Args>(args)...);
+    new_head->next = _head.load();
+
+    for (;;) {
+      new_head->link = new_head->next.get();
+      if (_head.compare_exchange(new_head->next, new_head))
+        break;
+      _count_cas_retry();
+    }
+    this->_notify_push();
+
+    return ref_t(std::move(new_head));
+  }
+
+  // Same as pushing the values one by one, the chain is built privately then
+  // spliced with a single CAS
+  template <class InputIt> void push_range(InputIt first, InputIt last) {
+    _count_op();
+    if (first == last)
+      return;
+
+    auto chain = _make_node(*first);
+    Node *chain_last = chain.get();
+    for (++first; first != last; ++first) {
+      auto node = _make_node(*first);
+      node->link = chain.get();
+      node->next = std::move(chain);
+      chain = std::move(node);
+    }
+
+    chain_last->next = _head.load();
+    for (;;) {
+      chain_last->link = chain_last->next.get();
+      if (_head.compare_exchange(chain_last->next, chain))
+        break;
+      _count_cas_retry();
+    }
+    this->_notify_push_range();
+  }
+
+  ref_t try_pop() {
+    _count_op();
+    my_intrusive_ptr<Node> node = _head.load();
+
+    while (node && !_head.compare_exchange(node, node->next))
+      _count_cas_retry();
+
+    if (!node)
+      _count_empty_pop();
+    return ref_t(std::move(node));
+  }
+
+  batch_t pop_all() {
+    _count_op();
+    return batch_t(_head.exchange(nullptr));
+  }
+
+  // No reference taken on the way, only on the node found: the nodes are read
+  // inside a critical section, and a released node found is skipped
+  ref_t find(const T &val) {
+    _count_op();
+    EpochGuard guard;
+
+    my_intrusive_ptr<Node> res;
+    std::size_t steps = 0;
+    for (Node *node = _head.peek(); node; node = node->link, ++steps)
+      if (node->val == val && (res = my_intrusive_ptr<Node>::lock(node)))
+        break;
+    _count_find(steps);
+
+    return ref_t(std::move(res));
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return !_head; }
+
+private:
+  Alloc _alloc;
+  my_atomic_intrusive_ptr<Node> _head;
+
+  // Each node keeps a copy of _alloc, to be freed with it
+  template <class... Args> my_intrusive_ptr<Node> _make_node(Args &&... args) {
+    return my_intrusive_ptr<Node>(
+        Deferred::create(_alloc, std::forward<Args>(args)...));
+  }
+};
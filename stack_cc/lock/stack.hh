@@ -2,51 +2,144 @@
 
 #include <memory>
 #include <mutex>
+#include <utility>
 
-template <class T> class Stack {
+#include "../batch_iterator.hh"
+#include "../chain_release.hh"
+#include "../stack_stats.hh"
+#include "../stack_wait.hh"
+
+template <class T, class Alloc = std::allocator<T>>
+class Stack : public StackCounters, public StackWait<Stack<T, Alloc>> {
 
   struct Node {
     T val;
     std::shared_ptr<Node> next;
 
-    Node(const T &val) : val(val) {}
+    template <class... Args>
+    Node(Args &&... args) : val(std::forward<Args>(args)...) {}
+
+    ~Node() { release_chain(std::move(next)); }
+
+    T &value() { return val; }
+    Node *next_node() const { return next.get(); }
   };
 
 public:
   using ref_t = std::shared_ptr<T>;
 
+  // Chain of nodes taken by pop_all, top of the stack first
+  class batch_t {
+  public:
+    using iterator = BatchIterator<Node, T>;
+
+    batch_t() = default;
+
+    batch_t(batch_t &&b) : _head(std::move(b._head)) {}
+
+    batch_t &operator=(batch_t &&b) {
+      batch_t{std::move(b)}.swap(*this);
+      return *this;
+    }
+
+    void swap(batch_t &b) { _head.swap(b._head); }
+
+    iterator begin() const { return iterator(_head.get()); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return !_head; }
+
+  private:
+    std::shared_ptr<Node> _head;
+
+    batch_t(std::shared_ptr<Node> head) : _head(std::move(head)) {}
+
+    friend class Stack;
+  };
+
   Stack() = default;
 
+  // Nodes are allocated through a copy of alloc, rebound to the node type
+  explicit Stack(const Alloc &alloc) : _alloc(alloc) {}
+
   Stack(const Stack &) = delete;
   Stack &operator=(const Stack &) = delete;
 
-  std::shared_ptr<T> push(const T &val) {
-    auto new_head = std::make_shared<Node>(val);
+  std::shared_ptr<T> push(const T &val) { return emplace(val); }
 
-    std::lock_guard<std::mutex> lock(_mut);
-    new_head->next = _head;
-    _head = new_head;
+  std::shared_ptr<T> push(T &&val) { return emplace(std::move(val)); }
+
+  // Constructs the value in place, inside the node
+  template <class... Args> std::shared_ptr<T> emplace(Args &&... args) {
+    auto new_head =
+        std::allocate_shared<Node>(_alloc, std::forward<Args>(args)...);
+
+    {
+      std::lock_guard<std::mutex> lock(_mut);
+      _count_op();
+      new_head->next = _head;
+      _head = new_head;
+    }
+    this->_notify_push();
     return std::shared_ptr<T>(new_head, &new_head->val);
   }
 
+  // Same as pushing the values one by one, in a single critical section
+  template <class InputIt> void push_range(InputIt first, InputIt last) {
+    _count_op();
+    if (first == last)
+      return;
+
+    auto chain = std::allocate_shared<Node>(_alloc, *first);
+    Node *chain_last = chain.get();
+    for (++first; first != last; ++first) {
+      auto node = std::allocate_shared<Node>(_alloc, *first);
+      node->next = std::move(chain);
+      chain = std::move(node);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(_mut);
+      chain_last->next = std::move(_head);
+      _head = std::move(chain);
+    }
+    this->_notify_push_range();
+  }
+
   std::shared_ptr<T> try_pop() {
     std::lock_guard<std::mutex> lock(_mut);
-    if (!_head)
+    _count_op();
+    if (!_head) {
+      _count_empty_pop();
       return nullptr;
+    }
 
     std::shared_ptr<T> res(_head, &_head->val);
-    _head = _head->next;
+    _head = std::move(_head->next);
     return res;
   }
 
+  batch_t pop_all() {
+    std::lock_guard<std::mutex> lock(_mut);
+    _count_op();
+    return batch_t(std::move(_head));
+  }
+
   std::shared_ptr<T> find(const T &val) {
     std::lock_guard<std::mutex> lock(_mut);
+    _count_op();
 
-    auto node = _head;
-    while (node && !(node->val == val))
-      node = node->next;
+    // The nodes can't be released under the lock, only the one found is
+    // referenced
+    const std::shared_ptr<Node> *node = &_head;
+    std::size_t steps = 0;
+    for (; *node && !((*node)->val == val); ++steps)
+      node = &(*node)->next;
+    _count_find(steps);
 
-    return std::shared_ptr<T>(node, &node->val);
+    if (!*node)
+      return nullptr;
+    return std::shared_ptr<T>(*node, &(*node)->val);
   }
 
   // Here for debug / test, unreliable values in multithread env
@@ -57,6 +150,7 @@ public:
   }
 
 private:
+  Alloc _alloc;
   mutable std::mutex _mut;
   std::shared_ptr<Node> _head;
 };
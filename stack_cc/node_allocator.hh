@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+// Creation / destruction of raw stack nodes through Alloc, rebound to Node
+// Alloc must be stateless: nodes are freed by deleters that only get a pointer
+template <class Node, class Alloc> struct NodeAllocator {
+  using Rebound =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+  using Traits = std::allocator_traits<Rebound>;
+
+  template <class... Args> static Node *create(Args &&... args) {
+    Rebound alloc;
+    Node *node = Traits::allocate(alloc, 1);
+    try {
+      Traits::construct(alloc, node, std::forward<Args>(args)...);
+    } catch (...) {
+      Traits::deallocate(alloc, node, 1);
+      throw;
+    }
+    return node;
+  }
+
+  static void destroy(Node *node) {
+    Rebound alloc;
+    Traits::destroy(alloc, node);
+    Traits::deallocate(alloc, node, 1);
+  }
+
+  // Deleter for hazard / epoch retire
+  static void destroy_void(void *ptr) { destroy(static_cast<Node *>(ptr)); }
+};
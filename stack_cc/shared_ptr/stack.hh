@@ -3,52 +3,168 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <utility>
 
-template <class T> class Stack {
+#include "../batch_iterator.hh"
+#include "../deferred_node.hh"
+#include "../stack_stats.hh"
+#include "../stack_wait.hh"
 
-  struct Node {
+// Nodes are retired instead of freed, find walks them without touching the
+// reference counts (deferred_node.hh)
+template <class T, class Alloc = std::allocator<T>>
+class Stack : public StackCounters, public StackWait<Stack<T, Alloc>> {
+
+  struct Node : DeferredNode<Node, Alloc>, std::enable_shared_from_this<Node> {
     T val;
     std::shared_ptr<Node> next;
 
-    Node(const T &val) : val(val) {}
+    template <class... Args>
+    Node(const Alloc &alloc, Args &&... args)
+        : DeferredNode<Node, Alloc>(alloc), val(std::forward<Args>(args)...) {}
+
+    T &value() { return val; }
+    Node *next_node() const { return next.get(); }
+  };
+
+  using Deferred = DeferredNode<Node, Alloc>;
+
+  // Deleter of the nodes
+  struct Release {
+    void operator()(Node *node) const { Deferred::release(node); }
   };
 
 public:
   using ref_t = std::shared_ptr<T>;
 
+  // Chain of nodes taken by pop_all, top of the stack first
+  class batch_t {
+  public:
+    using iterator = BatchIterator<Node, T>;
+
+    batch_t() = default;
+
+    batch_t(batch_t &&b) : _head(std::move(b._head)) {}
+
+    batch_t &operator=(batch_t &&b) {
+      batch_t{std::move(b)}.swap(*this);
+      return *this;
+    }
+
+    void swap(batch_t &b) { _head.swap(b._head); }
+
+    iterator begin() const { return iterator(_head.get()); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return !_head; }
+
+  private:
+    std::shared_ptr<Node> _head;
+
+    batch_t(std::shared_ptr<Node> head) : _head(std::move(head)) {}
+
+    friend class Stack;
+  };
+
   Stack() = default;
 
+  // Nodes are allocated through a copy of alloc, rebound to the node type
+  explicit Stack(const Alloc &alloc) : _alloc(alloc) {}
+
   Stack(const Stack &) = delete;
   Stack &operator=(const Stack &) = delete;
 
-  std::shared_ptr<T> push(const T &val) {
-    auto new_head = std::make_shared<Node>(val);
+  ~Stack() {
+    typename Deferred::FreeNow free_now;
+    std::shared_ptr<Node> head = std::move(_head);
+  }
+
+  std::shared_ptr<T> push(const T &val) { return emplace(val); }
+
+  std::shared_ptr<T> push(T &&val) { return emplace(std::move(val)); }
+
+  // Constructs the value in place, inside the node
+  template <class... Args> std::shared_ptr<T> emplace(Args &&... args) {
+    _count_op();
+    auto new_head = _make_node(std::forward<Args>(args)...);
     new_head->next = std::atomic_load(&_head);
 
-    while (
-        !std::atomic_compare_exchange_weak(&_head, &new_head->next, new_head))
-      continue;
+    for (;;) {
+      new_head->link = new_head->next.get();
+      if (std::atomic_compare_exchange_weak(&_head, &new_head->next, new_head))
+        break;
+      _count_cas_retry();
+    }
+    this->_notify_push();
 
     return std::shared_ptr<T>(new_head, &new_head->val);
   }
 
+  // Same as pushing the values one by one, the chain is built privately then
+  // spliced with a single CAS
+  template <class InputIt> void push_range(InputIt first, InputIt last) {
+    _count_op();
+    if (first == last)
+      return;
+
+    auto chain = _make_node(*first);
+    Node *chain_last = chain.get();
+    for (++first; first != last; ++first) {
+      auto node = _make_node(*first);
+      node->link = chain.get();
+      node->next = std::move(chain);
+      chain = std::move(node);
+    }
+
+    chain_last->next = std::atomic_load(&_head);
+    for (;;) {
+      chain_last->link = chain_last->next.get();
+      if (std::atomic_compare_exchange_weak(&_head, &chain_last->next, chain))
+        break;
+      _count_cas_retry();
+    }
+    this->_notify_push_range();
+  }
+
   std::shared_ptr<T> try_pop() {
+    _count_op();
     std::shared_ptr<Node> node = std::atomic_load(&_head);
 
     while (node &&
            !std::atomic_compare_exchange_weak(&_head, &node, node->next))
-      continue;
+      _count_cas_retry();
 
+    if (!node) {
+      _count_empty_pop();
+      return nullptr;
+    }
     return std::shared_ptr<T>(node, &node->val);
   }
 
-  std::shared_ptr<T> find(const T &val) {
-    std::shared_ptr<Node> node = std::atomic_load(&_head);
-
-    while (node && !(node->val == val))
-      node = node->next;
+  batch_t pop_all() {
+    _count_op();
+    return batch_t(std::atomic_exchange(&_head, std::shared_ptr<Node>()));
+  }
 
-    return std::shared_ptr<T>(node, &node->val);
+  // Only the head and the node found are referenced: the others are read
+  // inside a critical section, and a released node found is skipped
+  std::shared_ptr<T> find(const T &val) {
+    _count_op();
+    EpochGuard guard;
+
+    // Referenced after the section started, can't be freed before its end
+    Node *node = std::atomic_load(&_head).get();
+
+    std::shared_ptr<Node> res;
+    std::size_t steps = 0;
+    for (; node; node = node->link, ++steps)
+      if (node->val == val && (res = node->weak_from_this().lock()))
+        break;
+    _count_find(steps);
+
+    if (!res)
+      return nullptr;
+    return std::shared_ptr<T>(res, &res->val);
   }
 
   // Here for debug / test, unreliable values in multithread env
@@ -56,5 +172,13 @@ public:
   bool empty() const { return !_head; }
 
 private:
+  Alloc _alloc;
   std::shared_ptr<Node> _head;
+
+  // The control block is allocated through _alloc too
+  template <class... Args> std::shared_ptr<Node> _make_node(Args &&... args) {
+    return std::shared_ptr<Node>(
+        Deferred::create(_alloc, std::forward<Args>(args)...), Release{},
+        _alloc);
+  }
 };
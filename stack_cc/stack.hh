@@ -9,4 +9,22 @@
 #elif defined(IMPL_MY_SHARED_PTR)
 #include "my_shared_ptr/stack.hh"
 
+#elif defined(IMPL_INTRUSIVE)
+#include "intrusive/stack.hh"
+
+#elif defined(IMPL_HAZARD)
+#include "hazard/stack.hh"
+
+#elif defined(IMPL_EPOCH)
+#include "epoch/stack.hh"
+
+#elif defined(IMPL_TAGGED)
+#include "tagged/stack.hh"
+
+#elif defined(IMPL_ELIMINATION)
+#include "elimination/stack.hh"
+
+#elif defined(IMPL_FLAT_COMBINING)
+#include "flat_combining/stack.hh"
+
 #endif
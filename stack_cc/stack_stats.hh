@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "thread_index.hh"
+
+// Counters of a Stack, summed over all the threads
+struct StackStats {
+  std::uint64_t ops;         // every push, try_pop, pop_all, find call
+  std::uint64_t cas_retries; // failed CAS on the shared state
+  std::uint64_t empty_pops;  // try_pop on an empty stack
+  std::uint64_t finds;
+  std::uint64_t find_steps; // nodes skipped by find
+};
+
+#ifdef STACK_STATS
+
+// Per-thread counters, base of every Stack when STACK_STATS is defined
+//
+// Each thread gets its own padded slot: counting is a plain load / store on a
+// line owned by the thread, stats() sums the slots on demand.
+// Threads above MAX_THREADS share the last slot, with atomic increments.
+class StackCounters {
+public:
+  StackCounters() = default;
+
+  StackCounters(const StackCounters &) = delete;
+  StackCounters &operator=(const StackCounters &) = delete;
+
+  StackStats stats() const {
+    StackStats res{};
+    for (const auto &slot : _slots) {
+      res.ops += slot.val[OPS].load(std::memory_order_relaxed);
+      res.cas_retries += slot.val[CAS_RETRIES].load(std::memory_order_relaxed);
+      res.empty_pops += slot.val[EMPTY_POPS].load(std::memory_order_relaxed);
+      res.finds += slot.val[FINDS].load(std::memory_order_relaxed);
+      res.find_steps += slot.val[FIND_STEPS].load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+
+protected:
+  void _count_op() { _add(OPS, 1); }
+  void _count_cas_retry() { _add(CAS_RETRIES, 1); }
+  void _count_empty_pop() { _add(EMPTY_POPS, 1); }
+
+  void _count_find(std::size_t steps) {
+    _add(FINDS, 1);
+    _add(FIND_STEPS, steps);
+  }
+
+private:
+  static constexpr std::size_t MAX_THREADS = ThreadIndex::MAX;
+
+  enum Counter { OPS, CAS_RETRIES, EMPTY_POPS, FINDS, FIND_STEPS, NB_COUNTERS };
+
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> val[NB_COUNTERS] = {};
+  };
+
+  Slot _slots[MAX_THREADS + 1];
+
+  void _add(Counter c, std::uint64_t n) {
+    std::size_t index = ThreadIndex::get();
+    auto &val = _slots[index].val[c];
+
+    if (index < MAX_THREADS)
+      val.store(val.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+    else
+      val.fetch_add(n, std::memory_order_relaxed);
+  }
+};
+
+#else
+
+// No stats: empty base, every count is a no-op
+class StackCounters {
+protected:
+  void _count_op() {}
+  void _count_cas_retry() {}
+  void _count_empty_pop() {}
+  void _count_find(std::size_t) {}
+};
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include "../my_shared_ptr/spinlock.hh"
+#include "event_count.hh"
+
+// Blocking pops, base of every Stack (CRTP: Stack provides try_pop)
+//
+// A consumer spins on try_pop for a while, then parks on an event count.
+// Producers call _notify_push once their values are visible: a fence and a
+// load when nobody is parked, a futex wake otherwise.
+template <class Stack> class StackWait {
+public:
+  StackWait() = default;
+
+  StackWait(const StackWait &) = delete;
+  StackWait &operator=(const StackWait &) = delete;
+
+  auto wait_pop() {
+    if (auto res = _spin_pop())
+      return res;
+
+    for (;;) {
+      auto key = _pushed.prepare_wait();
+      if (auto res = _stack().try_pop()) {
+        _pushed.cancel_wait();
+        return res;
+      }
+      _pushed.wait(key);
+
+      if (auto res = _stack().try_pop())
+        return res;
+    }
+  }
+
+  // Empty handle if nothing was pushed before the timeout
+  template <class Rep, class Period>
+  auto wait_pop_for(const std::chrono::duration<Rep, Period> &timeout) {
+    return wait_pop_until(std::chrono::steady_clock::now() + timeout);
+  }
+
+  template <class Clock, class Duration>
+  auto
+  wait_pop_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+    if (auto res = _spin_pop())
+      return res;
+
+    for (;;) {
+      auto key = _pushed.prepare_wait();
+      if (auto res = _stack().try_pop()) {
+        _pushed.cancel_wait();
+        return res;
+      }
+      bool woken = _pushed.wait_until(key, deadline);
+
+      // Last try at the deadline
+      auto res = _stack().try_pop();
+      if (res || !woken)
+        return res;
+    }
+  }
+
+protected:
+  void _notify_push() { _pushed.notify_one(); }
+
+  void _notify_push_range() { _pushed.notify_all(); }
+
+private:
+  static constexpr std::size_t SPIN_POPS = 64;
+
+  EventCount _pushed;
+
+  Stack &_stack() { return static_cast<Stack &>(*this); }
+
+  auto _spin_pop() {
+    auto res = _stack().try_pop();
+    for (std::size_t i = 1; !res && i < SPIN_POPS; ++i) {
+      cpu_relax();
+      res = _stack().try_pop();
+    }
+    return res;
+  }
+};
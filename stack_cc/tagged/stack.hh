@@ -0,0 +1,411 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../batch_iterator.hh"
+#include "../node_allocator.hh"
+#include "../stack_stats.hh"
+#include "../stack_wait.hh"
+
+// Treiber stack with a tagged head, and nodes recycled through a free list
+//
+// The head is a {node, tag} pair, updated with a 16 bytes CAS (cmpxchg16b,
+// requires -mcx16). The tag is incremented on every update, so a pop fails if
+// the head was popped and pushed again in between (ABA).
+// Nodes are type-stable: they are never freed before the stack, only recycled
+// through a free list (a tagged stack too). A pop may read the next field of a
+// recycled node, but the CAS then fails because of the tag.
+//
+// find is protected by a counter of running finds: while it's not 0, released
+// nodes are deferred instead of recycled, and recycled when it drops to 0.
+// Handles don't keep that counter raised: they hold a reference on their node,
+// which is only released once the pop and all the handles dropped it.
+template <class T, class Alloc = std::allocator<T>>
+class Stack : public StackCounters, public StackWait<Stack<T, Alloc>> {
+
+  struct Node {
+    std::atomic<Node *> next;
+    Node *all_next;
+    Node *deferred_next;
+    // 1 for the stack (or the pop that took it) + 1 per push / find handle
+    std::atomic<unsigned> refs;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+
+    Node()
+        : next(nullptr), all_next(nullptr), deferred_next(nullptr), refs(0) {}
+
+    T *get_ptr() { return reinterpret_cast<T *>(&data); }
+
+    T &value() { return *get_ptr(); }
+    Node *next_node() const { return next.load(std::memory_order_relaxed); }
+  };
+
+  using NodeAlloc = NodeAllocator<Node, Alloc>;
+
+  struct alignas(16) Head {
+    Node *ptr;
+    std::uint64_t tag;
+  };
+
+public:
+  // Handle to a value of the stack, can't outlive the stack
+  // Holds a reference on the node, released on destruction
+  class ref_t {
+  public:
+    ref_t() : _stack(nullptr), _node(nullptr) {}
+
+    ref_t(ref_t &&r) : _stack(r._stack), _node(r._node) { r._node = nullptr; }
+
+    ref_t &operator=(ref_t &&r) {
+      ref_t{std::move(r)}.swap(*this);
+      return *this;
+    }
+
+    ref_t(const ref_t &) = delete;
+    ref_t &operator=(const ref_t &) = delete;
+
+    ~ref_t() {
+      if (_node)
+        _stack->_unref(_node);
+    }
+
+    void swap(ref_t &r) {
+      std::swap(_stack, r._stack);
+      std::swap(_node, r._node);
+    }
+
+    T *get() const { return _node ? _node->get_ptr() : nullptr; }
+    T &operator*() const { return *get(); }
+    T *operator->() const { return get(); }
+
+    operator bool() const { return _node != nullptr; }
+
+  private:
+    Stack *_stack;
+    Node *_node;
+
+    ref_t(Stack *stack, Node *node) : _stack(stack), _node(node) {}
+
+    friend class Stack;
+  };
+
+  // Chain of nodes taken by pop_all, top of the stack first, can't outlive the
+  // stack
+  // The whole chain is recycled at once on destruction
+  class batch_t {
+  public:
+    using iterator = BatchIterator<Node, T>;
+
+    batch_t() : _stack(nullptr), _head(nullptr) {}
+
+    batch_t(batch_t &&b) : _stack(b._stack), _head(b._head) {
+      b._head = nullptr;
+    }
+
+    batch_t &operator=(batch_t &&b) {
+      batch_t{std::move(b)}.swap(*this);
+      return *this;
+    }
+
+    batch_t(const batch_t &) = delete;
+    batch_t &operator=(const batch_t &) = delete;
+
+    ~batch_t() {
+      if (_head)
+        _stack->_release_chain(_head);
+    }
+
+    void swap(batch_t &b) {
+      std::swap(_stack, b._stack);
+      std::swap(_head, b._head);
+    }
+
+    iterator begin() const { return iterator(_head); }
+    iterator end() const { return iterator(); }
+
+    bool empty() const { return !_head; }
+
+  private:
+    Stack *_stack;
+    Node *_head;
+
+    batch_t(Stack *stack, Node *head) : _stack(stack), _head(head) {}
+
+    friend class Stack;
+  };
+
+  Stack()
+      : _head(Head{nullptr, 0}), _free(Head{nullptr, 0}), _all(nullptr),
+        _deferred(nullptr), _finders(0) {}
+
+  Stack(const Stack &) = delete;
+  Stack &operator=(const Stack &) = delete;
+
+  ~Stack() {
+    for (Node *node = _head.load().ptr; node; node = node->next.load())
+      node->get_ptr()->~T();
+    for (Node *node = _deferred.load(); node; node = node->deferred_next)
+      node->get_ptr()->~T();
+
+    Node *node = _all.load();
+    while (node) {
+      Node *next = node->all_next;
+      NodeAlloc::destroy(node);
+      node = next;
+    }
+  }
+
+  ref_t push(const T &val) { return emplace(val); }
+
+  ref_t push(T &&val) { return emplace(std::move(val)); }
+
+  // Constructs the value in place, inside the node
+  // The handle reference is taken before the node is reachable: no RMW
+  template <class... Args> ref_t emplace(Args &&... args) {
+    _count_op();
+    Node *node = _alloc_node();
+    new (node->get_ptr()) T(std::forward<Args>(args)...);
+    node->refs.store(2, std::memory_order_relaxed);
+
+    _push(_head, node, node);
+    this->_notify_push();
+
+    return ref_t(this, node);
+  }
+
+  // Same as pushing the values one by one, the chain is built privately then
+  // spliced with a single CAS
+  template <class InputIt> void push_range(InputIt first, InputIt last) {
+    _count_op();
+    if (first == last)
+      return;
+
+    Node *chain = _alloc_node();
+    new (chain->get_ptr()) T(*first);
+    chain->refs.store(1, std::memory_order_relaxed);
+    Node *chain_last = chain;
+    for (++first; first != last; ++first) {
+      Node *node = _alloc_node();
+      new (node->get_ptr()) T(*first);
+      node->refs.store(1, std::memory_order_relaxed);
+      node->next.store(chain, std::memory_order_relaxed);
+      chain = node;
+    }
+
+    _push(_head, chain, chain_last);
+    this->_notify_push_range();
+  }
+
+  ref_t try_pop() {
+    _count_op();
+    Node *node = _pop(_head);
+    if (!node)
+      _count_empty_pop();
+    return ref_t(this, node);
+  }
+
+  // seq_cst: the unlink must be ordered with the finds counter read
+  batch_t pop_all() {
+    _count_op();
+    Head old = _head.load(std::memory_order_acquire);
+    while (old.ptr &&
+           !_head.compare_exchange_weak(old, Head{nullptr, old.tag + 1},
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_acquire))
+      _count_cas_retry();
+
+    return batch_t(this, old.ptr);
+  }
+
+  // The running find only covers the walk, the handle holds a reference
+  ref_t find(const T &val) {
+    _count_op();
+    _finders.fetch_add(1, std::memory_order_seq_cst);
+
+    Node *node = _head.load(std::memory_order_seq_cst).ptr;
+    std::size_t steps = 0;
+    for (; node; ++steps) {
+      if (*node->get_ptr() == val && _try_ref(node))
+        break;
+      node = node->next.load(std::memory_order_acquire);
+    }
+    _count_find(steps);
+
+    _leave_find();
+    return ref_t(this, node);
+  }
+
+  // Here for debug / test, unreliable values in multithread env
+
+  bool empty() const { return !_head.load().ptr; }
+
+  // Nodes ever allocated, in the stack or not
+  std::size_t nodes_count() const {
+    std::size_t res = 0;
+    for (Node *node = _all.load(); node; node = node->all_next)
+      ++res;
+    return res;
+  }
+
+private:
+  std::atomic<Head> _head;
+  std::atomic<Head> _free;
+
+  // All nodes ever allocated, freed with the stack
+  std::atomic<Node *> _all;
+
+  // Released during a find, linked with deferred_next
+  std::atomic<Node *> _deferred;
+  std::atomic<std::size_t> _finders;
+
+  // Used by both the stack and the free list
+  void _push(std::atomic<Head> &head, Node *first, Node *last) {
+    Head old = head.load(std::memory_order_relaxed);
+    for (;;) {
+      last->next.store(old.ptr, std::memory_order_relaxed);
+      if (head.compare_exchange_weak(old, Head{first, old.tag + 1},
+                                     std::memory_order_release,
+                                     std::memory_order_relaxed))
+        return;
+      _count_cas_retry();
+    }
+  }
+
+  // seq_cst: the unlink must be ordered with the finds counter read
+  Node *_pop(std::atomic<Head> &head) {
+    Head old = head.load(std::memory_order_acquire);
+    for (;;) {
+      if (!old.ptr)
+        return nullptr;
+
+      // The node may already be recycled, then the tag changed
+      Node *next = old.ptr->next.load(std::memory_order_relaxed);
+      if (head.compare_exchange_weak(old, Head{next, old.tag + 1},
+                                     std::memory_order_seq_cst,
+                                     std::memory_order_acquire))
+        return old.ptr;
+      _count_cas_retry();
+    }
+  }
+
+  Node *_alloc_node() {
+    Node *node = _pop(_free);
+    if (node)
+      return node;
+
+    node = NodeAlloc::create();
+    node->all_next = _all.load(std::memory_order_relaxed);
+    while (!_all.compare_exchange_weak(node->all_next, node,
+                                       std::memory_order_relaxed))
+      continue;
+    return node;
+  }
+
+  // A find may still reach a node after its last reference is dropped, the
+  // count must not come back from 0
+  bool _try_ref(Node *node) {
+    unsigned refs = node->refs.load(std::memory_order_relaxed);
+    while (refs && !node->refs.compare_exchange_weak(
+                       refs, refs + 1, std::memory_order_relaxed))
+      continue;
+    return refs != 0;
+  }
+
+  // Drops the reference of a pop or a handle, the last one releases it
+  void _unref(Node *node) {
+    if (node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      _release(node, node);
+  }
+
+  // Chain taken by pop_all, ends with nullptr
+  // The prefix of nodes held by nothing else is released at once, the nodes
+  // after the first one held by a handle one by one
+  // A released node may be pushed to the free list, next is read before
+  void _release_chain(Node *first) {
+    Node *last = nullptr;
+    for (Node *node = first; node;) {
+      Node *next = node->next_node();
+      if (node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        if (last)
+          _release(first, last);
+        for (node = next; node; node = next) {
+          next = node->next_node();
+          _unref(node);
+        }
+        return;
+      }
+      last = node;
+      node = next;
+    }
+    _release(first, last);
+  }
+
+  // Chain from first to last linked with next, already unlinked from the stack
+  void _release(Node *first, Node *last) {
+    if (_finders.load(std::memory_order_seq_cst) == 0) {
+      for (Node *node = first;; node = node->next_node()) {
+        node->get_ptr()->~T();
+        if (node == last)
+          break;
+      }
+      _push(_free, first, last);
+      return;
+    }
+
+    // A find may still read them, the next fields must be preserved
+    for (Node *node = first; node != last; node = node->next_node())
+      node->deferred_next = node->next_node();
+    last->deferred_next = _deferred.load(std::memory_order_relaxed);
+    while (!_deferred.compare_exchange_weak(last->deferred_next, first,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed))
+      continue;
+
+    // The last find may have left before the push
+    if (_finders.load(std::memory_order_seq_cst) == 0)
+      _drain_deferred();
+  }
+
+  void _leave_find() {
+    if (_finders.fetch_sub(1, std::memory_order_seq_cst) == 1)
+      _drain_deferred();
+  }
+
+  void _drain_deferred() {
+    for (;;) {
+      Node *first = _deferred.exchange(nullptr, std::memory_order_seq_cst);
+      if (!first)
+        return;
+
+      Node *last = first;
+      while (last->deferred_next)
+        last = last->deferred_next;
+
+      // Deferred nodes were unlinked before, a find that started after this
+      // check can't reach them
+      if (_finders.load(std::memory_order_seq_cst) == 0) {
+        for (Node *node = first; node; node = node->deferred_next) {
+          node->get_ptr()->~T();
+          node->next.store(node->deferred_next, std::memory_order_relaxed);
+        }
+        _push(_free, first, last);
+        continue;
+      }
+
+      // Put them back, the running finds will drain them when leaving
+      last->deferred_next = _deferred.load(std::memory_order_relaxed);
+      while (!_deferred.compare_exchange_weak(last->deferred_next, first,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed))
+        continue;
+
+      if (_finders.load(std::memory_order_seq_cst) != 0)
+        return;
+    }
+  }
+};
@@ -0,0 +1,64 @@
+#include <atomic>
+#include <cassert>
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+#include "stack.hh"
+
+namespace {
+constexpr std::uint64_t ITEMS_COUNT = 1 * 1024 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 16;
+constexpr std::uint64_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+constexpr std::uint64_t BATCH_SIZE = 256;
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+static_assert(ITEMS_PER_THREAD % BATCH_SIZE == 0);
+
+Stack<std::uint64_t> g_stack;
+std::atomic<bool> g_ready;
+
+void runner_produce(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  std::vector<std::uint64_t> batch(BATCH_SIZE);
+  for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; i += BATCH_SIZE) {
+    for (std::uint64_t j = 0; j < BATCH_SIZE; ++j)
+      batch[j] = (i + j) << 32 | tid;
+    g_stack.push_range(batch.begin(), batch.end());
+  }
+}
+} // namespace
+
+TEST_CASE("N batch producers, then pop_all stack") {
+  REQUIRE(g_stack.pop_all().empty());
+
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+    ths.emplace_back(runner_produce, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  auto batch = g_stack.pop_all();
+  REQUIRE(g_stack.empty());
+
+  // Each range is spliced at once: its values stay contiguous
+  std::vector<std::uint64_t> exp(THREADS_COUNT, ITEMS_PER_THREAD);
+  std::uint64_t prev_tid = 0;
+  std::size_t count = 0;
+  for (std::uint64_t x : batch) {
+    std::uint64_t tid = x & 0xFFFFFFFF;
+    std::uint64_t val = x >> 32;
+    if (count++ % BATCH_SIZE != 0)
+      REQUIRE(tid == prev_tid);
+    REQUIRE(--exp[tid] == val);
+    prev_tid = tid;
+  }
+
+  REQUIRE(count == ITEMS_COUNT);
+  for (auto x : exp)
+    REQUIRE(x == 0);
+}
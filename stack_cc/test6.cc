@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+#include "stack.hh"
+
+namespace {
+constexpr std::uint64_t ITEMS_COUNT = 1 * 1024 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 16;
+constexpr std::uint64_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+constexpr std::uint64_t BATCH_SIZE = 256;
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+static_assert(ITEMS_PER_THREAD % BATCH_SIZE == 0);
+
+Stack<std::uint64_t> g_stack;
+std::atomic<bool> g_ready;
+
+std::array<std::atomic<std::size_t>, THREADS_COUNT> g_counts;
+std::atomic<std::size_t> g_total;
+
+void runner_produce(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  std::vector<std::uint64_t> batch(BATCH_SIZE);
+  for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; i += BATCH_SIZE) {
+    for (std::uint64_t j = 0; j < BATCH_SIZE; ++j)
+      batch[j] = (i + j) << 32 | tid;
+    g_stack.push_range(batch.begin(), batch.end());
+  }
+}
+
+// Drains with pop_all and try_pop while producers run
+void runner_consume() {
+  while (!g_ready)
+    continue;
+
+  std::vector<std::size_t> counts(THREADS_COUNT, 0);
+
+  while (g_total < ITEMS_COUNT) {
+    // Within a batch, values of a producer are in decreasing order
+    std::vector<std::uint64_t> exp(THREADS_COUNT, ITEMS_PER_THREAD);
+    std::size_t nb_popped = 0;
+
+    auto batch = g_stack.pop_all();
+    for (std::uint64_t x : batch) {
+      std::uint64_t tid = x & 0xFFFFFFFF;
+      std::uint64_t val = x >> 32;
+      REQUIRE(val < exp[tid]);
+      exp[tid] = val;
+      ++counts[tid];
+      ++nb_popped;
+    }
+
+    if (auto next = g_stack.try_pop()) {
+      ++counts[*next & 0xFFFFFFFF];
+      ++nb_popped;
+    }
+
+    if (!nb_popped)
+      std::this_thread::yield();
+    g_total += nb_popped;
+  }
+
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+    g_counts[i] += counts[i];
+}
+
+} // namespace
+
+TEST_CASE("N batch producers + N pop_all consumers") {
+  std::fill(g_counts.begin(), g_counts.end(), 0);
+  g_total = 0;
+
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i) {
+    ths.emplace_back(runner_produce, i);
+    ths.emplace_back(runner_consume);
+  }
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+    REQUIRE(g_counts[i] == ITEMS_PER_THREAD);
+  REQUIRE(g_stack.empty());
+}
@@ -36,8 +36,9 @@ class Val {
 public:
   Val(std::size_t pos) : _pos(pos) {}
 
-  Val(const Val &v) : _pos(v._pos) { v._pos = VAL_NONE; }
+  Val(Val &&v) : _pos(v._pos) { v._pos = VAL_NONE; }
 
+  Val(const Val &) = delete;
   Val &operator=(const Val &) = delete;
 
   ~Val() {
@@ -46,7 +47,7 @@ public:
   }
 
 private:
-  mutable std::size_t _pos;
+  std::size_t _pos;
 
   friend bool operator==(const Val &a, const Val &b) {
     return a._pos == b._pos;
@@ -87,15 +88,6 @@ void runner_find() {
   while (!g_ready)
     continue;
 
-    // Find in lock too slow to use it by all times
-#ifdef IMPL_LOCK
-  for (std::size_t i = 0; i < 10000; ++i) {
-    auto val = g_stack.find(Val{VAL_NONE});
-    REQUIRE(!val);
-  }
-  return;
-#endif
-
   while (!g_prod_finished) {
     auto val = g_stack.find(Val{VAL_NONE});
     REQUIRE(!val);
@@ -0,0 +1,93 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "stack.hh"
+
+namespace {
+constexpr std::uint64_t ITEMS_COUNT = 1 * 1024 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 16;
+constexpr std::uint64_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+Stack<std::uint64_t> g_stack;
+std::atomic<bool> g_ready;
+std::atomic<std::uint64_t> g_popped;
+std::atomic<std::uint64_t> g_sum;
+
+// A single pop after each push: the stack stays almost empty, pops often find
+// an empty head while pushes retry (and back off to the elimination array)
+void runner(std::uint64_t tid) {
+  while (!g_ready)
+    continue;
+
+  std::uint64_t popped = 0;
+  std::uint64_t sum = 0;
+  for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; ++i) {
+    g_stack.push(tid * ITEMS_PER_THREAD + i);
+    auto next = g_stack.try_pop();
+    if (next) {
+      ++popped;
+      sum += *next;
+    }
+  }
+
+  g_popped += popped;
+  g_sum += sum;
+}
+} // namespace
+
+TEST_CASE("N push / pop pairs around an empty stack") {
+  g_ready = false;
+  g_popped = 0;
+  g_sum = 0;
+
+  std::vector<std::thread> ths;
+  for (std::uint64_t i = 0; i < THREADS_COUNT; ++i)
+    ths.emplace_back(runner, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  // Nothing lost: what wasn't popped by the runners is still in the stack
+  for (auto next = g_stack.try_pop(); next; next = g_stack.try_pop()) {
+    ++g_popped;
+    g_sum += *next;
+  }
+  REQUIRE(g_popped == ITEMS_COUNT);
+  REQUIRE(g_sum == ITEMS_COUNT * (ITEMS_COUNT - 1) / 2);
+  REQUIRE(g_stack.empty());
+}
+
+#if defined(IMPL_ELIMINATION)
+namespace {
+// Stands for a push that backed off to the array, and waits there
+// The array starts with a single slot in use
+struct OfferingStack : Stack<int> {
+  using NodePtr = decltype(_slots[0].node.load());
+  using Node = std::remove_pointer_t<NodePtr>;
+
+  void offer(int val) {
+    _slots[0].node.store(NodeAllocator<Node, std::allocator<int>>::create(val));
+  }
+
+  bool offered() const { return _slots[0].node.load() != nullptr; }
+};
+} // namespace
+
+TEST_CASE("pop on an empty stack takes a node offered in the array") {
+  OfferingStack stack;
+  stack.offer(7);
+  REQUIRE(stack.empty());
+
+  auto next = stack.try_pop();
+  REQUIRE(next);
+  REQUIRE(*next == 7);
+  REQUIRE(!stack.offered());
+  REQUIRE(stack.empty());
+}
+#endif
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "stack.hh"
+#include "xorshift.hh"
+
+namespace {
+constexpr std::uint64_t KEEP_COUNT = 1024;
+constexpr std::uint64_t ITERS_COUNT = 64 * 1024;
+constexpr std::uint64_t FIND_COUNT = 4 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 4;
+
+Stack<std::uint64_t> g_stack;
+std::atomic<bool> g_ready;
+std::atomic<std::size_t> g_running;
+
+// Each pop follows a push of the same thread: the stack never gets below the
+// KEEP_COUNT values pushed first
+void runner_churn(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  for (std::uint64_t i = 0; i < ITERS_COUNT; ++i) {
+    g_stack.push(KEEP_COUNT + (i << 8 | tid));
+    auto next = g_stack.try_pop();
+    REQUIRE(next);
+    REQUIRE(*next >= KEEP_COUNT);
+  }
+  --g_running;
+}
+
+void runner_find(std::size_t tid) {
+  Xorshift rng(tid + 1);
+  while (!g_ready)
+    continue;
+
+  std::uint64_t i = 0;
+  for (; i < FIND_COUNT || g_running; ++i) {
+    std::uint64_t kept = rng.next(KEEP_COUNT);
+    auto found = g_stack.find(kept);
+    REQUIRE(found);
+    REQUIRE(*found == kept);
+
+    // Popped at any time, or never pushed
+    std::uint64_t churned = KEEP_COUNT + (i << 8 | tid);
+    auto maybe = g_stack.find(churned);
+    REQUIRE((!maybe || *maybe == churned));
+  }
+}
+} // namespace
+
+TEST_CASE("find while N threads push / pop") {
+  for (std::uint64_t i = 0; i < KEEP_COUNT; ++i)
+    g_stack.push(i);
+
+  g_ready = false;
+  g_running = THREADS_COUNT;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i) {
+    ths.emplace_back(runner_churn, i);
+    ths.emplace_back(runner_find, i);
+  }
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  for (std::uint64_t i = KEEP_COUNT; i-- > 0;) {
+    auto next = g_stack.try_pop();
+    REQUIRE(next);
+    REQUIRE(*next == i);
+  }
+  REQUIRE(g_stack.empty());
+}
+
+TEST_CASE("push returns a handle to the pushed value") {
+  Stack<int> stack;
+
+  {
+    auto ref = stack.push(7);
+    REQUIRE(ref);
+    REQUIRE(*ref == 7);
+
+    auto popped = stack.try_pop();
+    REQUIRE(popped);
+    REQUIRE(*popped == 7);
+    REQUIRE(*ref == 7);
+  }
+  REQUIRE(stack.empty());
+}
+
+TEST_CASE("push handle kept while values are pushed and popped") {
+  Stack<int> stack;
+  auto ref = stack.push(-1);
+
+  std::vector<int> range{1, 2, 3};
+  for (int i = 0; i < 64 * 1024; ++i) {
+    stack.push(i);
+    auto next = stack.try_pop();
+    REQUIRE(next);
+    REQUIRE(*next == i);
+
+    stack.push_range(range.begin(), range.end());
+    auto batch = stack.pop_all();
+    REQUIRE(!batch.empty());
+    REQUIRE(*ref == -1);
+  }
+  REQUIRE(stack.empty());
+  REQUIRE(*ref == -1);
+}
+
+#if defined(IMPL_EPOCH) || defined(IMPL_ELIMINATION)
+// Handles don't keep a critical section: the epoch keeps advancing while they
+// are alive, and they can be destroyed by another thread
+TEST_CASE("retained handles don't hold back the epoch") {
+  Stack<int> stack;
+  auto pushed = stack.push(1);
+  auto found = stack.find(1);
+  REQUIRE(found);
+
+  std::uint64_t epoch = EpochDomain::instance().epoch();
+  for (int i = 0; i < 64 * 1024; ++i) {
+    stack.push(i);
+    REQUIRE(stack.try_pop());
+  }
+  REQUIRE(EpochDomain::instance().epoch() >= epoch + 2);
+
+  auto popped = stack.try_pop();
+  REQUIRE(popped);
+  REQUIRE(stack.empty());
+
+  int sum = 0;
+  std::thread other([&] {
+    auto p = std::move(pushed);
+    auto f = std::move(found);
+    sum = *p + *f;
+  });
+  other.join();
+  REQUIRE(sum == 2);
+  REQUIRE(*popped == 1);
+}
+#endif
+
+#if defined(IMPL_TAGGED)
+// Handles don't keep a running find: popped nodes are still recycled
+TEST_CASE("retained find handle doesn't stop recycling") {
+  Stack<int> stack;
+  stack.push(1);
+  auto found = stack.find(1);
+  REQUIRE(found);
+
+  for (int i = 0; i < 64 * 1024; ++i) {
+    stack.push(i);
+    REQUIRE(stack.try_pop());
+  }
+  REQUIRE(stack.nodes_count() <= 4);
+
+  auto popped = stack.try_pop();
+  REQUIRE(popped);
+  REQUIRE(stack.empty());
+  REQUIRE(*found == 1);
+}
+#endif
+
+#if !defined(IMPL_TAGGED)
+// Only the tagged stack recycles its nodes, its handles can't outlive it
+TEST_CASE("push and find handles outlive the stack") {
+  auto stack = std::make_unique<Stack<std::vector<int>>>();
+  auto pushed = stack->push(std::vector<int>(64, 1));
+  stack->push(std::vector<int>(64, 2));
+  auto found = stack->find(std::vector<int>(64, 2));
+  REQUIRE(found);
+
+  stack.reset();
+  REQUIRE(*pushed == std::vector<int>(64, 1));
+  REQUIRE(*found == std::vector<int>(64, 2));
+}
+#endif
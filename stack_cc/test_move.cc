@@ -0,0 +1,120 @@
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "stack.hh"
+
+namespace {
+
+constexpr std::size_t ITEMS_COUNT = 256 * 1024;
+constexpr std::size_t THREADS_COUNT = 8;
+constexpr std::size_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+// Counts copies, must never be copied by the stack
+struct Msg {
+  static std::atomic<std::size_t> copies;
+
+  std::string text;
+  std::vector<int> data;
+
+  Msg(std::string text, std::size_t size) : text(std::move(text)), data(size) {}
+
+  Msg(Msg &&) = default;
+  Msg(const Msg &m) : text(m.text), data(m.data) { ++copies; }
+
+  Msg &operator=(const Msg &) = delete;
+};
+
+std::atomic<std::size_t> Msg::copies{};
+
+Stack<std::unique_ptr<std::size_t>> g_stack;
+std::atomic<bool> g_ready;
+std::atomic<std::size_t> g_sum;
+
+void runner_prod_cons(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  std::size_t sum = 0;
+  for (std::size_t i = 0; i < ITEMS_PER_THREAD; ++i) {
+    g_stack.push(std::make_unique<std::size_t>(tid * ITEMS_PER_THREAD + i));
+
+    for (;;) {
+      auto next = g_stack.try_pop();
+      if (!next)
+        continue;
+      std::unique_ptr<std::size_t> val = std::move(*next);
+      sum += *val;
+      break;
+    }
+  }
+
+  g_sum += sum;
+}
+
+} // namespace
+
+TEST_CASE("move only push / emplace / pop") {
+  Stack<std::unique_ptr<int>> stack;
+  stack.push(std::make_unique<int>(1));
+  stack.emplace(new int(2));
+
+  std::vector<std::unique_ptr<int>> range;
+  range.push_back(std::make_unique<int>(3));
+  range.push_back(std::make_unique<int>(4));
+  stack.push_range(std::make_move_iterator(range.begin()),
+                   std::make_move_iterator(range.end()));
+  REQUIRE(!range[0]);
+
+  for (int i = 4; i > 0; --i) {
+    auto next = stack.try_pop();
+    REQUIRE(next);
+    std::unique_ptr<int> val = std::move(*next);
+    REQUIRE(*val == i);
+  }
+  REQUIRE(stack.empty());
+}
+
+TEST_CASE("emplace / push rvalue without copy") {
+  Msg::copies = 0;
+
+  Stack<Msg> stack;
+  stack.emplace("emplaced", 100);
+  stack.push(Msg("moved", 200));
+
+  Msg msg("range", 300);
+  stack.push_range(std::make_move_iterator(&msg),
+                   std::make_move_iterator(&msg + 1));
+  REQUIRE(msg.data.empty());
+
+  auto batch = stack.pop_all();
+  std::vector<std::string> texts;
+  for (Msg &m : batch)
+    texts.push_back(m.text);
+
+  REQUIRE(texts == std::vector<std::string>{"range", "moved", "emplaced"});
+  REQUIRE(Msg::copies == 0);
+}
+
+TEST_CASE("move only N consumer / producer") {
+  g_ready = false;
+  g_sum = 0;
+
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i)
+    ths.emplace_back(runner_prod_cons, i);
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(g_sum == ITEMS_COUNT * (ITEMS_COUNT - 1) / 2);
+  REQUIRE(g_stack.empty());
+}
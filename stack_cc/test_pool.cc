@@ -0,0 +1,120 @@
+#include <atomic>
+#include <cassert>
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+#include "../node_pool/node_pool.hh"
+#include "stack.hh"
+
+namespace {
+constexpr std::uint64_t ITEMS_COUNT = 1 * 1024 * 1024;
+constexpr std::uint64_t THREADS_COUNT = 8;
+constexpr std::uint64_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+static_assert(ITEMS_COUNT % THREADS_COUNT == 0);
+
+using PoolStack = Stack<std::uint64_t, PoolAllocator<std::uint64_t>>;
+
+std::atomic<bool> g_ready;
+std::atomic<std::uint64_t> g_sum;
+
+// Nodes are pushed by a thread and popped (freed) by others
+void runner_produce(PoolStack *stack, std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; ++i)
+    stack->push(tid * ITEMS_PER_THREAD + i);
+}
+
+void runner_consume(PoolStack *stack) {
+  while (!g_ready)
+    continue;
+
+  std::uint64_t sum = 0;
+  for (std::uint64_t i = 0; i < ITEMS_PER_THREAD; ++i) {
+    for (;;) {
+      auto next = stack->try_pop();
+      if (!next)
+        continue;
+      sum += *next;
+      break;
+    }
+  }
+  g_sum += sum;
+}
+
+// Stateful allocator: counts the blocks it has live
+template <class T> class CountingAllocator {
+public:
+  using value_type = T;
+
+  explicit CountingAllocator(std::atomic<long> *live) : _live(live) {}
+
+  template <class U>
+  CountingAllocator(const CountingAllocator<U> &other) : _live(other._live) {}
+
+  T *allocate(std::size_t n) {
+    ++*_live;
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *ptr, std::size_t n) {
+    --*_live;
+    std::allocator<T>{}.deallocate(ptr, n);
+  }
+
+  template <class U> bool operator==(const CountingAllocator<U> &o) const {
+    return _live == o._live;
+  }
+
+  template <class U> bool operator!=(const CountingAllocator<U> &o) const {
+    return _live != o._live;
+  }
+
+private:
+  std::atomic<long> *_live;
+
+  template <class U> friend class CountingAllocator;
+};
+} // namespace
+
+TEST_CASE("pool allocator, N producers + N consumers") {
+  g_ready = false;
+  g_sum = 0;
+
+  {
+    PoolStack stack;
+    std::vector<std::thread> ths;
+    for (std::size_t i = 0; i < THREADS_COUNT; ++i) {
+      ths.emplace_back(runner_produce, &stack, i);
+      ths.emplace_back(runner_consume, &stack);
+    }
+
+    g_ready = true;
+    for (auto &t : ths)
+      t.join();
+
+    REQUIRE(stack.empty());
+  }
+
+  REQUIRE(g_sum == ITEMS_COUNT * (ITEMS_COUNT - 1) / 2);
+}
+
+#if defined(IMPL_LOCK) || defined(IMPL_SHARED_PTR) ||                        \
+    defined(IMPL_MY_SHARED_PTR) || defined(IMPL_INTRUSIVE) ||                 \
+    defined(IMPL_FLAT_COMBINING)
+TEST_CASE("nodes are allocated with the allocator given to the stack") {
+  std::atomic<long> live(0);
+
+  {
+    Stack<int, CountingAllocator<int>> stack{CountingAllocator<int>(&live)};
+    for (int i = 0; i < 16; ++i)
+      stack.push(i);
+    REQUIRE(live > 0);
+  }
+
+  // Nodes still on the stack are freed by its destructor
+  REQUIRE(live == 0);
+}
+#endif
@@ -0,0 +1,87 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "stack.hh"
+
+// Built with STACK_STATS only
+
+namespace {
+
+constexpr std::size_t THREADS_COUNT = 8;
+constexpr std::size_t ITEMS_PER_THREAD = 10000;
+
+// Above the number of private slots, some threads share the last one
+constexpr std::size_t MANY_THREADS_COUNT = 80;
+
+void run_threads(Stack<int> &stack, std::size_t nb_threads) {
+  std::atomic<bool> ready{false};
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < nb_threads; ++i)
+    ths.emplace_back([&] {
+      while (!ready)
+        std::this_thread::yield();
+
+      for (std::size_t j = 0; j < ITEMS_PER_THREAD; ++j) {
+        stack.push(int(j));
+        stack.try_pop();
+      }
+    });
+
+  ready = true;
+  for (auto &t : ths)
+    t.join();
+}
+
+} // namespace
+
+TEST_CASE("stats single thread") {
+  Stack<int> stack;
+
+  StackStats stats = stack.stats();
+  REQUIRE(stats.ops == 0);
+  REQUIRE(stats.cas_retries == 0);
+
+  for (int i = 0; i < 10; ++i)
+    stack.push(i);
+
+  // 9 at the top
+  REQUIRE(stack.find(6));
+  REQUIRE(!stack.find(42));
+
+  for (int i = 0; i < 12; ++i)
+    stack.try_pop();
+
+  stack.push(1);
+  stack.pop_all();
+
+  // Counted even if empty
+  std::vector<int> none;
+  stack.push_range(none.begin(), none.end());
+
+  stats = stack.stats();
+  REQUIRE(stats.ops == 10 + 2 + 12 + 2 + 1);
+  REQUIRE(stats.cas_retries == 0);
+  REQUIRE(stats.empty_pops == 2);
+  REQUIRE(stats.finds == 2);
+  REQUIRE(stats.find_steps == 3 + 10);
+}
+
+TEST_CASE("stats multi threads") {
+  Stack<int> stack;
+  run_threads(stack, THREADS_COUNT);
+
+  StackStats stats = stack.stats();
+  REQUIRE(stats.ops == 2 * THREADS_COUNT * ITEMS_PER_THREAD);
+  REQUIRE(stats.empty_pops <= THREADS_COUNT * ITEMS_PER_THREAD);
+  REQUIRE(stack.empty());
+}
+
+TEST_CASE("stats more threads than slots") {
+  Stack<int> stack;
+  run_threads(stack, MANY_THREADS_COUNT);
+
+  REQUIRE(stack.stats().ops == 2 * MANY_THREADS_COUNT * ITEMS_PER_THREAD);
+}
@@ -0,0 +1,59 @@
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "stack.hh"
+
+// Destroying a long chain must not recurse node by node: the call stack
+// would overflow long before the end
+namespace {
+constexpr std::uint32_t ITEMS_COUNT = 16 * 1024 * 1024;
+constexpr std::uint32_t RANGE_SIZE = 1024;
+
+static_assert(ITEMS_COUNT % RANGE_SIZE == 0);
+
+void fill(Stack<std::uint32_t> &stack) {
+  std::vector<std::uint32_t> range(RANGE_SIZE);
+  for (std::uint32_t i = 0; i < ITEMS_COUNT; i += RANGE_SIZE) {
+    for (std::uint32_t j = 0; j < RANGE_SIZE; ++j)
+      range[j] = i + j;
+    stack.push_range(range.begin(), range.end());
+  }
+}
+} // namespace
+
+TEST_CASE("destroy a stack of tens of millions of values") {
+  auto stack = std::make_unique<Stack<std::uint32_t>>();
+  for (std::uint32_t i = 0; i < ITEMS_COUNT; ++i)
+    stack->push(i);
+  REQUIRE(!stack->empty());
+  stack.reset();
+}
+
+TEST_CASE("drop a pop_all batch of tens of millions of values") {
+  Stack<std::uint32_t> stack;
+  fill(stack);
+
+  {
+    auto batch = stack.pop_all();
+    REQUIRE(!batch.empty());
+    REQUIRE(*batch.begin() == ITEMS_COUNT - 1);
+  }
+  REQUIRE(stack.empty());
+}
+
+#if defined(IMPL_LOCK) || defined(IMPL_SHARED_PTR) ||                        \
+    defined(IMPL_MY_SHARED_PTR) || defined(IMPL_INTRUSIVE) ||                 \
+    defined(IMPL_FLAT_COMBINING)
+// Handles own their node, and the rest of the chain below it
+TEST_CASE("drop the last handle to a long chain") {
+  auto stack = std::make_unique<Stack<std::uint32_t>>();
+  fill(*stack);
+
+  auto top = stack->find(ITEMS_COUNT - 1);
+  REQUIRE(top);
+  stack.reset();
+  REQUIRE(*top == ITEMS_COUNT - 1);
+}
+#endif
@@ -0,0 +1,119 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "stack.hh"
+
+namespace {
+constexpr std::size_t ITEMS_COUNT = 64 * 1024;
+constexpr std::size_t THREADS_COUNT = 4;
+constexpr std::size_t ITEMS_PER_THREAD = ITEMS_COUNT / THREADS_COUNT;
+constexpr std::size_t RANGE_SIZE = 16;
+
+static_assert(ITEMS_PER_THREAD % RANGE_SIZE == 0);
+
+struct ValCounter {
+  std::atomic<int> n;
+  char offset[64]; // to avoid false sharing
+
+  ValCounter() : n(0) {}
+};
+
+Stack<std::size_t> g_stack;
+std::atomic<bool> g_ready;
+std::vector<ValCounter> g_out(ITEMS_COUNT);
+
+// Pauses now and then, so that consumers run out of values and park
+void runner_produce(std::size_t tid) {
+  while (!g_ready)
+    continue;
+
+  std::size_t first = tid * ITEMS_PER_THREAD;
+  for (std::size_t i = 0; i < ITEMS_PER_THREAD; i += RANGE_SIZE) {
+    if (i % (ITEMS_PER_THREAD / 8) == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    if (tid % 2) {
+      std::vector<std::size_t> range(RANGE_SIZE);
+      for (std::size_t j = 0; j < RANGE_SIZE; ++j)
+        range[j] = first + i + j;
+      g_stack.push_range(range.begin(), range.end());
+    } else {
+      for (std::size_t j = 0; j < RANGE_SIZE; ++j)
+        g_stack.push(first + i + j);
+    }
+  }
+}
+
+void runner_consume(bool timed) {
+  while (!g_ready)
+    continue;
+
+  for (std::size_t i = 0; i < ITEMS_PER_THREAD; ++i) {
+    Stack<std::size_t>::ref_t next;
+    if (timed) {
+      // Retries after a timeout
+      do
+        next = g_stack.wait_pop_for(std::chrono::milliseconds(1));
+      while (!next);
+    } else
+      next = g_stack.wait_pop();
+    REQUIRE(next);
+    ++g_out[*next].n;
+  }
+}
+} // namespace
+
+TEST_CASE("wait_pop_for timeout") {
+  REQUIRE(g_stack.empty());
+
+  auto start = std::chrono::steady_clock::now();
+  auto res = g_stack.wait_pop_for(std::chrono::milliseconds(20));
+  REQUIRE(!res);
+  REQUIRE(std::chrono::steady_clock::now() - start >=
+          std::chrono::milliseconds(20));
+
+  // Deadline already reached
+  REQUIRE(!g_stack.wait_pop_until(std::chrono::steady_clock::now()));
+
+  g_stack.push(12);
+  res = g_stack.wait_pop_until(std::chrono::system_clock::now());
+  REQUIRE(res);
+  REQUIRE(*res == 12);
+}
+
+TEST_CASE("wait_pop wakes up on push") {
+  std::thread consumer([] {
+    auto res = g_stack.wait_pop();
+    REQUIRE(res);
+    REQUIRE(*res == 15);
+  });
+
+  // Gives time to park
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  g_stack.push(15);
+  consumer.join();
+  REQUIRE(g_stack.empty());
+}
+
+TEST_CASE("N producers + N waiting consumers") {
+  for (auto &x : g_out)
+    x.n = 0;
+
+  g_ready = false;
+  std::vector<std::thread> ths;
+  for (std::size_t i = 0; i < THREADS_COUNT; ++i) {
+    ths.emplace_back(runner_produce, i);
+    ths.emplace_back(runner_consume, i % 2 == 0);
+  }
+
+  g_ready = true;
+  for (auto &t : ths)
+    t.join();
+
+  REQUIRE(g_stack.empty());
+  for (const auto &x : g_out)
+    REQUIRE(x.n == 1);
+}
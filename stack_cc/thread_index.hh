@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Small index of the calling thread, for per-thread slots
+//
+// Indices are given back when their thread exits, and reused by new threads.
+// Threads above MAX all get MAX: the caller keeps a shared slot for them.
+class ThreadIndex {
+public:
+  static constexpr std::size_t MAX = 64;
+
+  static std::size_t get() {
+    thread_local ThreadIndex res;
+    return res._index;
+  }
+
+  ThreadIndex(const ThreadIndex &) = delete;
+  ThreadIndex &operator=(const ThreadIndex &) = delete;
+
+private:
+  std::size_t _index;
+
+  ThreadIndex() : _index(MAX) {
+    for (std::size_t i = 0; i < MAX; ++i) {
+      bool used = false;
+      if (!_used()[i].load(std::memory_order_relaxed) &&
+          _used()[i].compare_exchange_strong(used, true,
+                                             std::memory_order_acquire)) {
+        _index = i;
+        break;
+      }
+    }
+  }
+
+  ~ThreadIndex() {
+    if (_index < MAX)
+      _used()[_index].store(false, std::memory_order_release);
+  }
+
+  static std::atomic<bool> *_used() {
+    static std::atomic<bool> res[MAX] = {};
+    return res;
+  }
+};